@@ -0,0 +1,280 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include "coremark.h"
+
+#ifndef ITERATIONS
+#define ITERATIONS 1
+#endif
+
+#ifdef PICOSOC
+#define reg_uart_clkdiv (*(volatile uint32_t*)0x02000004)
+#define reg_uart_data (*(volatile uint32_t*)0x02000008)
+#define reg_leds (*(volatile uint32_t*)0x03000000)
+
+#define reg_smz_pager_ctrl (*(volatile uint32_t*)0x02000020)
+#define reg_smz_pager_hits (*(volatile uint32_t*)0x02000024)
+#define reg_smz_pager_faults (*(volatile uint32_t*)0x02000028)
+#define reg_smz_pager_writebacks (*(volatile uint32_t*)0x0200002c)
+#define smz_pager_window ((void*)0x02800000)
+#else
+#define reg_console (*(volatile uint32_t*)0x10000000)
+#define reg_tests_passed (*(volatile uint32_t*)0x20000000)
+#endif
+
+#if VALIDATION_RUN
+volatile ee_s32 seed1_volatile = 0x3415;
+volatile ee_s32 seed2_volatile = 0x3415;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PERFORMANCE_RUN
+volatile ee_s32 seed1_volatile = 0x0;
+volatile ee_s32 seed2_volatile = 0x0;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PROFILE_RUN
+volatile ee_s32 seed1_volatile = 0x8;
+volatile ee_s32 seed2_volatile = 0x8;
+volatile ee_s32 seed3_volatile = 0x8;
+#endif
+volatile ee_s32 seed4_volatile = ITERATIONS;
+volatile ee_s32 seed5_volatile = 0;
+
+ee_u32 default_num_contexts = 1;
+
+// core_main.c reports each CRC that differs from the known value for the
+// seeds as "... should be ...", the run passes if there are none
+static int crc_errors;
+
+// --------------------------------------------------------
+
+static void putchar_raw(char c)
+{
+#ifdef PICOSOC
+	if (c == '\n')
+		reg_uart_data = '\r';
+	reg_uart_data = c;
+#else
+	reg_console = c;
+#endif
+}
+
+static void print_num(uint32_t val, int base, int neg, int width, char pad, int left)
+{
+	char buffer[12];
+	int n = 0;
+
+	do {
+		buffer[n++] = "0123456789abcdef"[val % base];
+		val /= base;
+	} while (val);
+	if (neg)
+		buffer[n++] = '-';
+
+	for (int i = n; !left && i < width; i++)
+		putchar_raw(pad);
+	for (int i = n; i > 0; i--)
+		putchar_raw(buffer[i - 1]);
+	for (int i = n; left && i < width; i++)
+		putchar_raw(' ');
+}
+
+static int contains(const char *s, const char *word)
+{
+	for (; *s; s++) {
+		int i = 0;
+		while (word[i] && s[i] == word[i])
+			i++;
+		if (!word[i])
+			return 1;
+	}
+	return 0;
+}
+
+// %[-][0][width][l]{d,i,u,x,s,c}, all that core_main.c uses without HAS_FLOAT
+int ee_printf(const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+
+	if (contains(fmt, "should be"))
+		crc_errors++;
+
+	for (; *fmt; fmt++) {
+		if (*fmt != '%') {
+			putchar_raw(*fmt);
+			continue;
+		}
+		int left = *++fmt == '-';
+		if (left)
+			fmt++;
+		char pad = *fmt == '0' ? '0' : ' ';
+		int width = 0;
+		while (*fmt >= '0' && *fmt <= '9')
+			width = 10 * width + *fmt++ - '0';
+		while (*fmt == 'l')
+			fmt++;
+
+		switch (*fmt) {
+		case 'd':
+		case 'i': {
+			int32_t v = va_arg(ap, int32_t);
+			print_num(v < 0 ? -(uint32_t)v : (uint32_t)v, 10, v < 0, width, pad, left);
+			break;
+		}
+		case 'u':
+			print_num(va_arg(ap, uint32_t), 10, 0, width, pad, left);
+			break;
+		case 'x':
+		case 'X':
+			print_num(va_arg(ap, uint32_t), 16, 0, width, pad, left);
+			break;
+		case 's': {
+			const char *s = va_arg(ap, const char *);
+			int n = 0;
+			while (s[n])
+				n++;
+			for (int i = n; !left && i < width; i++)
+				putchar_raw(' ');
+			while (*s)
+				putchar_raw(*s++);
+			for (int i = n; left && i < width; i++)
+				putchar_raw(' ');
+			break;
+		}
+		case 'c':
+			putchar_raw(va_arg(ap, int));
+			break;
+		case '%':
+			putchar_raw('%');
+			break;
+		case 0:
+			fmt--;
+			break;
+		}
+	}
+
+	va_end(ap);
+	return 0;
+}
+
+// GCC emits calls to these for struct copies and loops it recognizes
+void *memcpy(void *dest, const void *src, size_t n)
+{
+	char *d = dest;
+	const char *s = src;
+	while (n--)
+		*d++ = *s++;
+	return dest;
+}
+
+void *memset(void *s, int c, size_t n)
+{
+	char *p = s;
+	while (n--)
+		*p++ = c;
+	return s;
+}
+
+// --------------------------------------------------------
+
+static CORE_TICKS start_time_val, stop_time_val;
+
+static CORE_TICKS rdcycle(void)
+{
+	CORE_TICKS cycles;
+	asm volatile ("rdcycle %0" : "=r"(cycles));
+	return cycles;
+}
+
+void start_time(void)
+{
+	start_time_val = rdcycle();
+}
+
+void stop_time(void)
+{
+	stop_time_val = rdcycle();
+}
+
+CORE_TICKS get_time(void)
+{
+	return stop_time_val - start_time_val;
+}
+
+secs_ret time_in_secs(CORE_TICKS ticks)
+{
+	return ticks / EE_TICKS_PER_SEC;
+}
+
+// --------------------------------------------------------
+
+#ifndef COREMARK_SMZ
+#ifdef PICOSOC
+static ee_u8 coremark_block[TOTAL_DATA_SIZE] __attribute__((aligned(16)));
+#endif
+#endif
+
+void *portable_malloc(ee_size_t size)
+{
+	(void)size;
+#ifdef PICOSOC
+#ifdef COREMARK_SMZ
+	return smz_pager_window;
+#else
+	return coremark_block;
+#endif
+#else
+	return (void*)COREMARK_BLOCK;
+#endif
+}
+
+void portable_free(void *p)
+{
+	(void)p;
+}
+
+void portable_init(core_portable *p, int *argc, char *argv[])
+{
+	(void)argc;
+	(void)argv;
+#ifdef PICOSOC
+	reg_uart_clkdiv = 104;
+#ifdef COREMARK_SMZ
+	// drop all pages and clear the counters
+	reg_smz_pager_ctrl = 3;
+#endif
+#endif
+	if (sizeof(ee_ptr_int) != sizeof(ee_u8 *))
+		ee_printf("ERROR! Please define ee_ptr_int to a type that holds a pointer!\n");
+	if (sizeof(ee_u32) != 4)
+		ee_printf("ERROR! Please define ee_u32 to a 32b unsigned type!\n");
+	p->portable_id = 1;
+}
+
+// CoreMark/MHz is iterations per million cycles, independent of the clock
+void portable_fini(core_portable *p)
+{
+	uint32_t cycles = get_time();
+	uint32_t score = cycles ? (uint64_t)seed4_volatile * 1000000000ULL / cycles : 0;
+
+	ee_printf("CoreMark/MHz     : %u.%03u\n", score / 1000, score % 1000);
+#ifdef PICOSOC
+#ifdef COREMARK_SMZ
+	ee_printf("SMZ pager        : %u hits, %u faults, %u writebacks\n", reg_smz_pager_hits,
+			reg_smz_pager_faults, reg_smz_pager_writebacks);
+#endif
+	// icebreaker_tb.v with COREMARK waits for these
+	reg_leds = crc_errors ? 0x81 : 0xff;
+#else
+	if (!crc_errors)
+		reg_tests_passed = 123456789;
+#endif
+	p->portable_id = 0;
+}
@@ -0,0 +1,101 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// CoreMark port for the PicoRV32 testbench (axi4_memory in ../testbench.v)
+// and for PicoSoC on the IceBreaker (-DPICOSOC). See README.
+
+#ifndef CORE_PORTME_H
+#define CORE_PORTME_H
+
+#include <stddef.h>
+
+#define HAS_FLOAT 0
+#define HAS_TIME_H 0
+#define USE_CLOCK 0
+#define HAS_STDIO 0
+#define HAS_PRINTF 0
+
+#ifndef COMPILER_VERSION
+#define COMPILER_VERSION "GCC " __VERSION__
+#endif
+#ifndef COMPILER_FLAGS
+#define COMPILER_FLAGS FLAGS_STR
+#endif
+
+// The list, matrix and state working sets are thirds of one block of
+// TOTAL_DATA_SIZE bytes from portable_malloc(): at COREMARK_BLOCK in the
+// testbench, where the SMZ region of the run decides which of them are
+// secure, and in the secure window of the SMZ pager (COREMARK_SMZ) or in
+// SRAM on PicoSoC.
+#ifdef PICOSOC
+#  ifdef COREMARK_SMZ
+#    define MEM_LOCATION "SMZ pager window"
+#  else
+#    define MEM_LOCATION "SRAM"
+#  endif
+#else
+#  ifndef COREMARK_BLOCK
+#    define COREMARK_BLOCK 0x18000
+#  endif
+#  define MEM_LOCATION_STR(x) #x
+#  define MEM_LOCATION_XSTR(x) MEM_LOCATION_STR(x)
+#  define MEM_LOCATION "block at " MEM_LOCATION_XSTR(COREMARK_BLOCK)
+#endif
+
+typedef signed short ee_s16;
+typedef unsigned short ee_u16;
+typedef signed int ee_s32;
+typedef double ee_f32;
+typedef unsigned char ee_u8;
+typedef unsigned int ee_u32;
+typedef ee_u32 ee_ptr_int;
+typedef size_t ee_size_t;
+
+#define align_mem(x) (void *)(4 + (((ee_ptr_int)(x) - 1) & ~3))
+
+// rdcycle, CoreMark/MHz needs no clock frequency
+#define CORETIMETYPE ee_u32
+typedef ee_u32 CORE_TICKS;
+
+#ifndef CLOCK_MHZ
+#define CLOCK_MHZ 100
+#endif
+#define EE_TICKS_PER_SEC (CLOCK_MHZ * 1000000)
+
+#define SEED_METHOD SEED_VOLATILE
+#define MEM_METHOD MEM_MALLOC
+
+#define MULTITHREAD 1
+#define USE_PTHREAD 0
+#define USE_FORK 0
+#define USE_SOCKET 0
+
+#define MAIN_HAS_NOARGC 1
+#define MAIN_HAS_NORETURN 0
+
+extern ee_u32 default_num_contexts;
+
+typedef struct CORE_PORTABLE_S {
+	ee_u8 portable_id;
+} core_portable;
+
+void portable_init(core_portable *p, int *argc, char *argv[]);
+void portable_fini(core_portable *p);
+
+#if !defined(PROFILE_RUN) && !defined(PERFORMANCE_RUN) && !defined(VALIDATION_RUN)
+#  if (TOTAL_DATA_SIZE == 1200)
+#    define PROFILE_RUN 1
+#  elif (TOTAL_DATA_SIZE == 2000)
+#    define PERFORMANCE_RUN 1
+#  else
+#    define VALIDATION_RUN 1
+#  endif
+#endif
+
+int ee_printf(const char *fmt, ...);
+
+#endif
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+# This is free and unencumbered software released into the public domain.
+#
+# Anyone is free to copy, modify, publish, use, compile, sell, or
+# distribute this software, either in source code form or as a compiled
+# binary, for any purpose, commercial or non-commercial, and by any
+# means.
+#
+# CoreMark/MHz for each SMZ cipher configuration and working set placement.
+#
+#   coremark_report.py [--testbench F] [--firmware F] [--block ADDR]
+#                      [--cipher C ...] [--placement P ...]
+#
+# Runs coremark.hex on testbench_verilator once without SMZ and then for
+# every cipher and placement. A placement is the SMZ region of the run: the
+# whole working set block at COREMARK_BLOCK or one of its list, matrix and
+# state thirds (core_main.c splits the block in this order, the matrix
+# starts at the next word). The ciphers are the two testbench keystreams and
+# the keystream latency of the iterative picorv32_smz ciphers with their
+# default parameters (CIPHER_ROUNDS 4, CIPHER_LINE_WORDS 8).
+#
+
+import argparse, os, re, subprocess, sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(HERE, "..")
+
+TOTAL_DATA_SIZE = 2000
+KEY = "0f1e2d3c4b5a69788796a5b4c3d2e1f0"
+
+# name: plusargs
+CIPHERS = [
+    ("addr", ["+smz_cipher=0"]),
+    ("key XOR", ["+smz_cipher=1", "+smz_key=" + KEY]),
+    # ROUNDS + 1 cycles
+    ("ARX x4", ["+smz_cipher=1", "+smz_key=" + KEY, "+smz_latency=5"]),
+    # ROUNDS/2 + 1 cycles with CIPHER_CLK2X
+    ("ARX x4 clk2x", ["+smz_cipher=1", "+smz_key=" + KEY, "+smz_latency=3"]),
+    # load, initialization and the words up to a random one of the line,
+    # see picosoc/smz_cipher_report.py
+    ("Trivium", ["+smz_cipher=1", "+smz_key=" + KEY, "+smz_latency=42"]),
+]
+
+def align4(x):
+    return (x + 3) & ~3
+
+def placements(block):
+    third = TOTAL_DATA_SIZE // 3
+    return [
+        ("all", block, block + TOTAL_DATA_SIZE),
+        ("list", block, block + align4(third)),
+        ("matrix", block + align4(third), block + 2 * third),
+        ("state", block + 2 * third, block + TOTAL_DATA_SIZE),
+    ]
+
+def run(testbench, firmware, plusargs):
+    cmd = [testbench, "+firmware=" + firmware, "+nohist"] + plusargs
+    try:
+        out = subprocess.run(cmd, cwd=ROOT, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                universal_newlines=True).stdout
+    except OSError as e:
+        sys.exit("coremark_report: %s: %s" % (testbench, e))
+    m = re.search(r"CoreMark/MHz\s*:\s*([\d.]+)", out)
+    if not m or "ALL TESTS PASSED" not in out:
+        sys.stdout.write(out)
+        sys.exit("coremark_report: run failed: %s" % " ".join(plusargs))
+    return float(m.group(1))
+
+parser = argparse.ArgumentParser(description="CoreMark/MHz per SMZ cipher and placement")
+parser.add_argument("--testbench", default=os.path.join(ROOT, "testbench_verilator"))
+parser.add_argument("--firmware", default="coremark/coremark.hex", help="relative to the repository root")
+parser.add_argument("--block", type=lambda x: int(x, 0), default=0x18000, help="COREMARK_BLOCK of the build")
+parser.add_argument("--cipher", action="append", help="only these ciphers (%s)" % ", ".join(c for c, _ in CIPHERS))
+parser.add_argument("--placement", action="append", help="only these placements (all, list, matrix, state)")
+args = parser.parse_args()
+
+ciphers = [c for c in CIPHERS if not args.cipher or c[0] in args.cipher]
+places = [p for p in placements(args.block) if not args.placement or p[0] in args.placement]
+
+base = run(args.testbench, args.firmware, ["+smz_enable=0"])
+print("no SMZ: %.3f CoreMark/MHz" % base)
+print()
+for place, lo, hi in places:
+    print("%-8s +smz_base=%x +smz_size=%x" % (place, lo, hi - lo))
+print()
+print("%-14s" % "cipher" + "".join("%14s" % p for p, _, _ in places))
+for name, plusargs in ciphers:
+    row = "%-14s" % name
+    for place, lo, hi in places:
+        score = run(args.testbench, args.firmware, plusargs + ["+smz_base=%x" % lo, "+smz_size=%x" % (hi - lo)])
+        row += "%8.3f %+4.0f%%" % (score, 100.0 * (score - base) / base)
+    print(row)
@@ -113,6 +113,14 @@ module testbench;
 		end
 	end
 
+`ifdef SIMPOINT
+`define SIMPOINT_CORE uut
+`define SIMPOINT_MEM memory
+`define SIMPOINT_MEM_WORD(a) {memory[(a)+3], memory[(a)+2], memory[(a)+1], memory[(a)]}
+`define SIMPOINT_RESET_ADDR 32'h 10000
+`include "simpoint.vh"
+`endif
+
 `ifdef TIMING
 	initial begin
 		repeat (100000) @(posedge clk);
@@ -0,0 +1,534 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// AES-128-GCM and SHA-256, once in plain rv32im code (T-table AES, 4-bit
+// table GHASH) and once with the picorv32_pcpi_crypto instructions (see
+// crypto_ops.h). Both are checked against known answers and against each
+// other, and their cycles per byte are printed.
+
+#include "firmware.h"
+#include "crypto_ops.h"
+
+#define CRYPTO_BYTES 64
+
+static uint8_t aes_sbox[256];
+static uint32_t aes_te0[256];
+
+static inline uint32_t rol32(uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t ror32(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load_le(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store_le(uint8_t *p, uint32_t v)
+{
+	p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+static inline uint32_t load_be(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static inline void store_be(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24, p[1] = v >> 16, p[2] = v >> 8, p[3] = v;
+}
+
+static inline uint32_t rdcycle(void)
+{
+	uint32_t cycles;
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles));
+	return cycles;
+}
+
+// ---- AES-128, state and round keys as little endian column words ----
+
+static void aes_tables(void)
+{
+	uint8_t p = 1, q = 1;
+
+	// walk the multiplicative group with generator 3, q = 1/p
+	do {
+		p = p ^ (p << 1) ^ (p & 0x80 ? 0x1b : 0);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80)
+			q ^= 0x09;
+		uint8_t x = q ^ (uint8_t)(q << 1 | q >> 7) ^ (uint8_t)(q << 2 | q >> 6) ^
+				(uint8_t)(q << 3 | q >> 5) ^ (uint8_t)(q << 4 | q >> 4);
+		aes_sbox[p] = x ^ 0x63;
+	} while (p != 1);
+	aes_sbox[0] = 0x63;
+
+	for (int i = 0; i < 256; i++) {
+		uint32_t s = aes_sbox[i];
+		uint32_t s2 = (s << 1) ^ (s & 0x80 ? 0x11b : 0);
+		aes_te0[i] = s2 | s << 8 | s << 16 | (s2 ^ s) << 24;
+	}
+}
+
+// one output column of ShiftRows and SubBytes
+static inline uint32_t aes_shift_sub(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	return aes_sbox[a & 0xff] | aes_sbox[(b >> 8) & 0xff] << 8 |
+			aes_sbox[(c >> 16) & 0xff] << 16 | (uint32_t)aes_sbox[d >> 24] << 24;
+}
+
+static uint32_t aes_subword_sw(uint32_t w)
+{
+	return aes_shift_sub(w, w, w, w);
+}
+
+static uint32_t aes_subword_hw(uint32_t w)
+{
+	return aes32esi(aes32esi(aes32esi(aes32esi(0, w, 0), w, 1), w, 2), w, 3);
+}
+
+static void aes128_key(const uint8_t *key, uint32_t *rk, bool hw)
+{
+	uint32_t rcon = 1;
+	for (int i = 0; i < 4; i++)
+		rk[i] = load_le(key + 4*i);
+	for (int i = 4; i < 44; i++) {
+		uint32_t t = rk[i-1];
+		if (i % 4 == 0) {
+			t = ror32(t, 8);
+			t = (hw ? aes_subword_hw(t) : aes_subword_sw(t)) ^ rcon;
+			rcon = (rcon << 1) ^ (rcon & 0x80 ? 0x11b : 0);
+		}
+		rk[i] = rk[i-4] ^ t;
+	}
+}
+
+static void aes128_enc_sw(const uint32_t *rk, const uint8_t *in, uint8_t *out)
+{
+	uint32_t s0 = load_le(in) ^ rk[0], s1 = load_le(in + 4) ^ rk[1];
+	uint32_t s2 = load_le(in + 8) ^ rk[2], s3 = load_le(in + 12) ^ rk[3];
+	uint32_t t0, t1, t2, t3;
+
+	for (int r = 1; r < 10; r++) {
+		rk += 4;
+		t0 = rk[0] ^ aes_te0[s0 & 0xff] ^ rol32(aes_te0[(s1 >> 8) & 0xff], 8) ^
+				rol32(aes_te0[(s2 >> 16) & 0xff], 16) ^ rol32(aes_te0[s3 >> 24], 24);
+		t1 = rk[1] ^ aes_te0[s1 & 0xff] ^ rol32(aes_te0[(s2 >> 8) & 0xff], 8) ^
+				rol32(aes_te0[(s3 >> 16) & 0xff], 16) ^ rol32(aes_te0[s0 >> 24], 24);
+		t2 = rk[2] ^ aes_te0[s2 & 0xff] ^ rol32(aes_te0[(s3 >> 8) & 0xff], 8) ^
+				rol32(aes_te0[(s0 >> 16) & 0xff], 16) ^ rol32(aes_te0[s1 >> 24], 24);
+		t3 = rk[3] ^ aes_te0[s3 & 0xff] ^ rol32(aes_te0[(s0 >> 8) & 0xff], 8) ^
+				rol32(aes_te0[(s1 >> 16) & 0xff], 16) ^ rol32(aes_te0[s2 >> 24], 24);
+		s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+	}
+
+	rk += 4;
+	store_le(out,      rk[0] ^ aes_shift_sub(s0, s1, s2, s3));
+	store_le(out + 4,  rk[1] ^ aes_shift_sub(s1, s2, s3, s0));
+	store_le(out + 8,  rk[2] ^ aes_shift_sub(s2, s3, s0, s1));
+	store_le(out + 12, rk[3] ^ aes_shift_sub(s3, s0, s1, s2));
+}
+
+static void aes128_enc_hw(const uint32_t *rk, const uint8_t *in, uint8_t *out)
+{
+	uint32_t s0 = load_le(in) ^ rk[0], s1 = load_le(in + 4) ^ rk[1];
+	uint32_t s2 = load_le(in + 8) ^ rk[2], s3 = load_le(in + 12) ^ rk[3];
+	uint32_t t0, t1, t2, t3;
+
+	for (int r = 1; r < 10; r++) {
+		rk += 4;
+		t0 = aes32esmi(aes32esmi(aes32esmi(aes32esmi(rk[0], s0, 0), s1, 1), s2, 2), s3, 3);
+		t1 = aes32esmi(aes32esmi(aes32esmi(aes32esmi(rk[1], s1, 0), s2, 1), s3, 2), s0, 3);
+		t2 = aes32esmi(aes32esmi(aes32esmi(aes32esmi(rk[2], s2, 0), s3, 1), s0, 2), s1, 3);
+		t3 = aes32esmi(aes32esmi(aes32esmi(aes32esmi(rk[3], s3, 0), s0, 1), s1, 2), s2, 3);
+		s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+	}
+
+	rk += 4;
+	store_le(out,      aes32esi(aes32esi(aes32esi(aes32esi(rk[0], s0, 0), s1, 1), s2, 2), s3, 3));
+	store_le(out + 4,  aes32esi(aes32esi(aes32esi(aes32esi(rk[1], s1, 0), s2, 1), s3, 2), s0, 3));
+	store_le(out + 8,  aes32esi(aes32esi(aes32esi(aes32esi(rk[2], s2, 0), s3, 1), s0, 2), s1, 3));
+	store_le(out + 12, aes32esi(aes32esi(aes32esi(aes32esi(rk[3], s3, 0), s0, 1), s1, 2), s2, 3));
+}
+
+// equivalent inverse cipher, only used to check aes32dsi/aes32dsmi
+static void aes128_dec_hw(const uint32_t *rk, const uint8_t *in, uint8_t *out)
+{
+	uint32_t s0 = load_le(in) ^ rk[40], s1 = load_le(in + 4) ^ rk[41];
+	uint32_t s2 = load_le(in + 8) ^ rk[42], s3 = load_le(in + 12) ^ rk[43];
+	uint32_t t0, t1, t2, t3, k[4];
+
+	for (int r = 9; r > 0; r--) {
+		// InvMixColumns of the round key: aes32esi undoes the inverse S-box
+		for (int i = 0; i < 4; i++) {
+			uint32_t w = rk[4*r + i];
+			k[i] = aes32dsmi(aes32dsmi(aes32dsmi(aes32dsmi(0,
+					aes32esi(0, w, 0), 0), aes32esi(0, w, 1), 1),
+					aes32esi(0, w, 2), 2), aes32esi(0, w, 3), 3);
+		}
+		t0 = aes32dsmi(aes32dsmi(aes32dsmi(aes32dsmi(k[0], s0, 0), s3, 1), s2, 2), s1, 3);
+		t1 = aes32dsmi(aes32dsmi(aes32dsmi(aes32dsmi(k[1], s1, 0), s0, 1), s3, 2), s2, 3);
+		t2 = aes32dsmi(aes32dsmi(aes32dsmi(aes32dsmi(k[2], s2, 0), s1, 1), s0, 2), s3, 3);
+		t3 = aes32dsmi(aes32dsmi(aes32dsmi(aes32dsmi(k[3], s3, 0), s2, 1), s1, 2), s0, 3);
+		s0 = t0, s1 = t1, s2 = t2, s3 = t3;
+	}
+
+	store_le(out,      aes32dsi(aes32dsi(aes32dsi(aes32dsi(rk[0], s0, 0), s3, 1), s2, 2), s1, 3));
+	store_le(out + 4,  aes32dsi(aes32dsi(aes32dsi(aes32dsi(rk[1], s1, 0), s0, 1), s3, 2), s2, 3));
+	store_le(out + 8,  aes32dsi(aes32dsi(aes32dsi(aes32dsi(rk[2], s2, 0), s1, 1), s0, 2), s3, 3));
+	store_le(out + 12, aes32dsi(aes32dsi(aes32dsi(aes32dsi(rk[3], s3, 0), s2, 1), s1, 2), s0, 3));
+}
+
+// ---- GHASH, field elements as four big endian words ----
+
+struct gcm_ctx {
+	uint32_t rk[44];
+	uint32_t h[4];
+	uint64_t hl[16], hh[16];
+	bool hw;
+};
+
+static const uint16_t ghash_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static void ghash_table(struct gcm_ctx *ctx)
+{
+	uint64_t vh = (uint64_t)ctx->h[0] << 32 | ctx->h[1];
+	uint64_t vl = (uint64_t)ctx->h[2] << 32 | ctx->h[3];
+
+	ctx->hh[0] = ctx->hl[0] = 0;
+	ctx->hh[8] = vh, ctx->hl[8] = vl;
+	for (int i = 4; i > 0; i >>= 1) {
+		uint64_t t = (vl & 1) ? 0xe1000000 : 0;
+		vl = vh << 63 | vl >> 1;
+		vh = vh >> 1 ^ t << 32;
+		ctx->hh[i] = vh, ctx->hl[i] = vl;
+	}
+	for (int i = 2; i <= 8; i *= 2)
+		for (int j = 1; j < i; j++) {
+			ctx->hh[i+j] = ctx->hh[i] ^ ctx->hh[j];
+			ctx->hl[i+j] = ctx->hl[i] ^ ctx->hl[j];
+		}
+}
+
+static void ghash_mul_sw(const struct gcm_ctx *ctx, uint32_t *x)
+{
+	uint8_t b[16];
+	for (int i = 0; i < 4; i++)
+		store_be(b + 4*i, x[i]);
+
+	int lo = b[15] & 15;
+	uint64_t zh = ctx->hh[lo], zl = ctx->hl[lo];
+
+	for (int i = 15; i >= 0; i--) {
+		int hi = b[i] >> 4, rem;
+		lo = b[i] & 15;
+		if (i != 15) {
+			rem = zl & 15;
+			zl = zh << 60 | zl >> 4;
+			zh = zh >> 4 ^ (uint64_t)ghash_last4[rem] << 48;
+			zh ^= ctx->hh[lo], zl ^= ctx->hl[lo];
+		}
+		rem = zl & 15;
+		zl = zh << 60 | zl >> 4;
+		zh = zh >> 4 ^ (uint64_t)ghash_last4[rem] << 48;
+		zh ^= ctx->hh[hi], zl ^= ctx->hl[hi];
+	}
+
+	x[0] = zh >> 32, x[1] = zh, x[2] = zl >> 32, x[3] = zl;
+}
+
+// v ^= (s >> n) for 128 bit values, 0 < n < 32
+static inline void xor_shr128(uint32_t *v, const uint32_t *s, int n)
+{
+	v[3] ^= s[3] >> n | s[2] << (32 - n);
+	v[2] ^= s[2] >> n | s[1] << (32 - n);
+	v[1] ^= s[1] >> n | s[0] << (32 - n);
+	v[0] ^= s[0] >> n;
+}
+
+// multiply by x^128 mod x^128 + x^7 + x^2 + x + 1 (bit reflected) into z
+static inline void ghash_fold(uint32_t *z, const uint32_t *v)
+{
+	for (int i = 0; i < 4; i++)
+		z[i] ^= v[i];
+	xor_shr128(z, v, 1);
+	xor_shr128(z, v, 2);
+	xor_shr128(z, v, 7);
+}
+
+static void ghash_mul_hw(const struct gcm_ctx *ctx, uint32_t *x)
+{
+	uint32_t p[8] = { 0 }, o[4] = { 0 };
+
+	// 256 bit carry-less product, p[0] is the most significant word
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++) {
+			p[i+j] ^= clmulh(x[i], ctx->h[j]);
+			p[i+j+1] ^= clmul(x[i], ctx->h[j]);
+		}
+
+	// bit reflection leaves the product one bit short
+	for (int i = 0; i < 7; i++)
+		p[i] = p[i] << 1 | p[i+1] >> 31;
+	p[7] <<= 1;
+
+	// the bits that the x^1, x^2 and x^7 terms shift out of the low half
+	o[0] = p[7] << 31 ^ p[7] << 30 ^ p[7] << 25;
+	ghash_fold(p, p + 4);
+	ghash_fold(p, o);
+
+	for (int i = 0; i < 4; i++)
+		x[i] = p[i];
+}
+
+static void gcm_init(struct gcm_ctx *ctx, const uint8_t *key, bool hw)
+{
+	uint8_t zero[16] = { 0 }, h[16];
+
+	ctx->hw = hw;
+	aes128_key(key, ctx->rk, hw);
+	if (hw)
+		aes128_enc_hw(ctx->rk, zero, h);
+	else
+		aes128_enc_sw(ctx->rk, zero, h);
+	for (int i = 0; i < 4; i++)
+		ctx->h[i] = load_be(h + 4*i);
+	if (!hw)
+		ghash_table(ctx);
+}
+
+// AES-128-GCM with a 96 bit IV and no additional data, len is a multiple of 16
+static void gcm_encrypt(const struct gcm_ctx *ctx, const uint8_t *iv,
+		const uint8_t *in, uint8_t *out, int len, uint8_t *tag)
+{
+	uint8_t ctr[16], ks[16];
+	uint32_t x[4] = { 0 };
+
+	for (int i = 0; i < 12; i++)
+		ctr[i] = iv[i];
+	store_be(ctr + 12, 1);
+
+	for (int n = 0; n < len; n += 16) {
+		store_be(ctr + 12, 2 + n / 16);
+		if (ctx->hw)
+			aes128_enc_hw(ctx->rk, ctr, ks);
+		else
+			aes128_enc_sw(ctx->rk, ctr, ks);
+		for (int i = 0; i < 16; i++)
+			out[n+i] = in[n+i] ^ ks[i];
+		for (int i = 0; i < 4; i++)
+			x[i] ^= load_be(out + n + 4*i);
+		if (ctx->hw)
+			ghash_mul_hw(ctx, x);
+		else
+			ghash_mul_sw(ctx, x);
+	}
+
+	// length block: 0 bits of AAD, 8*len bits of ciphertext
+	x[3] ^= 8 * len;
+	if (ctx->hw)
+		ghash_mul_hw(ctx, x);
+	else
+		ghash_mul_sw(ctx, x);
+
+	store_be(ctr + 12, 1);
+	if (ctx->hw)
+		aes128_enc_hw(ctx->rk, ctr, ks);
+	else
+		aes128_enc_sw(ctx->rk, ctr, ks);
+	for (int i = 0; i < 4; i++)
+		store_be(tag + 4*i, x[i] ^ load_be(ks + 4*i));
+}
+
+// ---- SHA-256 ----
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_BLOCK(_name, _sum0, _sum1, _sig0, _sig1) \
+static void _name(uint32_t *state, const uint8_t *block) \
+{ \
+	uint32_t w[64], a = state[0], b = state[1], c = state[2], d = state[3]; \
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7]; \
+	for (int i = 0; i < 16; i++) \
+		w[i] = load_be(block + 4*i); \
+	for (int i = 16; i < 64; i++) \
+		w[i] = _sig1(w[i-2]) + w[i-7] + _sig0(w[i-15]) + w[i-16]; \
+	for (int i = 0; i < 64; i++) { \
+		uint32_t t1 = h + _sum1(e) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i]; \
+		uint32_t t2 = _sum0(a) + ((a & b) ^ (a & c) ^ (b & c)); \
+		h = g, g = f, f = e, e = d + t1; \
+		d = c, c = b, b = a, a = t1 + t2; \
+	} \
+	state[0] += a, state[1] += b, state[2] += c, state[3] += d; \
+	state[4] += e, state[5] += f, state[6] += g, state[7] += h; \
+}
+
+#define SW_SUM0(x) (ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22))
+#define SW_SUM1(x) (ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25))
+#define SW_SIG0(x) (ror32(x, 7) ^ ror32(x, 18) ^ ((x) >> 3))
+#define SW_SIG1(x) (ror32(x, 17) ^ ror32(x, 19) ^ ((x) >> 10))
+
+SHA256_BLOCK(sha256_block_sw, SW_SUM0, SW_SUM1, SW_SIG0, SW_SIG1)
+SHA256_BLOCK(sha256_block_hw, sha256sum0, sha256sum1, sha256sig0, sha256sig1)
+
+// len < 2^29, the tail of the message is padded in a local buffer
+static void sha256(const uint8_t *msg, int len, uint8_t *digest, bool hw)
+{
+	uint32_t state[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	uint8_t block[128];
+	int n = 0, r, blocks;
+
+	for (; n + 64 <= len; n += 64)
+		if (hw)
+			sha256_block_hw(state, msg + n);
+		else
+			sha256_block_sw(state, msg + n);
+
+	r = len - n;
+	blocks = r < 56 ? 1 : 2;
+	for (int i = 0; i < r; i++)
+		block[i] = msg[n+i];
+	block[r] = 0x80;
+	for (int i = r + 1; i < 64*blocks - 8; i++)
+		block[i] = 0;
+	store_be(block + 64*blocks - 8, (uint32_t)len >> 29);
+	store_be(block + 64*blocks - 4, (uint32_t)len << 3);
+
+	for (int i = 0; i < blocks; i++)
+		if (hw)
+			sha256_block_hw(state, block + 64*i);
+		else
+			sha256_block_sw(state, block + 64*i);
+
+	for (int i = 0; i < 8; i++)
+		store_be(digest + 4*i, state[i]);
+}
+
+// ---- benchmark ----
+
+static void crypto_check(const char *name, const uint8_t *a, const uint8_t *b, int len)
+{
+	for (int i = 0; i < len; i++)
+		if (a[i] != b[i]) {
+			print_str(name);
+			print_str(" ERROR!\n");
+			__asm__ volatile ("ebreak");
+		}
+}
+
+static void crypto_print_cpb(const char *name, uint32_t sw, uint32_t hw)
+{
+	print_str(name);
+	print_str(" rv32im ");
+	print_dec(sw / CRYPTO_BYTES);
+	print_chr('.');
+	print_dec((100 * sw / CRYPTO_BYTES) % 100 / 10);
+	print_dec((100 * sw / CRYPTO_BYTES) % 10);
+	print_str(" cpb, crypto ");
+	print_dec(hw / CRYPTO_BYTES);
+	print_chr('.');
+	print_dec((100 * hw / CRYPTO_BYTES) % 100 / 10);
+	print_dec((100 * hw / CRYPTO_BYTES) % 10);
+	print_str(" cpb\n");
+}
+
+void crypto(void)
+{
+	static const uint8_t sha256_abc[32] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+	};
+	// AES-GCM test case 2: zero key, zero IV, one zero block
+	static const uint8_t gcm_ct[16] = {
+		0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78
+	};
+	static const uint8_t gcm_tag[16] = {
+		0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd, 0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf
+	};
+	static struct gcm_ctx ctx_sw, ctx_hw;
+	static uint8_t data[CRYPTO_BYTES], out_sw[CRYPTO_BYTES], out_hw[CRYPTO_BYTES];
+	uint8_t key[16], iv[12], tag_sw[16], tag_hw[16], dec[16];
+	uint32_t t_sw, t_hw;
+
+	aes_tables();
+
+	for (int i = 0; i < 16; i++)
+		key[i] = 0;
+	for (int i = 0; i < 12; i++)
+		iv[i] = 0;
+	for (int i = 0; i < 16; i++)
+		data[i] = 0;
+
+	sha256((const uint8_t *)"abc", 3, out_sw, false);
+	sha256((const uint8_t *)"abc", 3, out_hw, true);
+	crypto_check("sha256 rv32im", out_sw, sha256_abc, 32);
+	crypto_check("sha256 crypto", out_hw, sha256_abc, 32);
+
+	gcm_init(&ctx_sw, key, false);
+	gcm_init(&ctx_hw, key, true);
+	gcm_encrypt(&ctx_sw, iv, data, out_sw, 16, tag_sw);
+	gcm_encrypt(&ctx_hw, iv, data, out_hw, 16, tag_hw);
+	crypto_check("aes-gcm rv32im", out_sw, gcm_ct, 16);
+	crypto_check("aes-gcm rv32im tag", tag_sw, gcm_tag, 16);
+	crypto_check("aes-gcm crypto", out_hw, gcm_ct, 16);
+	crypto_check("aes-gcm crypto tag", tag_hw, gcm_tag, 16);
+
+	aes128_dec_hw(ctx_hw.rk, gcm_ct, dec);
+	aes128_enc_sw(ctx_sw.rk, dec, out_sw);
+	crypto_check("aes decrypt", out_sw, gcm_ct, 16);
+
+	for (int i = 0; i < 16; i++)
+		key[i] = 17 * i + 1;
+	for (int i = 0; i < 12; i++)
+		iv[i] = 0xca ^ i;
+	for (int i = 0; i < CRYPTO_BYTES; i++)
+		data[i] = 3 * i;
+
+	t_sw = rdcycle();
+	sha256(data, CRYPTO_BYTES, out_sw, false);
+	t_sw = rdcycle() - t_sw;
+	t_hw = rdcycle();
+	sha256(data, CRYPTO_BYTES, out_hw, true);
+	t_hw = rdcycle() - t_hw;
+	crypto_check("sha256", out_sw, out_hw, 32);
+	crypto_print_cpb("sha256 ", t_sw, t_hw);
+
+	t_sw = rdcycle();
+	gcm_init(&ctx_sw, key, false);
+	gcm_encrypt(&ctx_sw, iv, data, out_sw, CRYPTO_BYTES, tag_sw);
+	t_sw = rdcycle() - t_sw;
+	t_hw = rdcycle();
+	gcm_init(&ctx_hw, key, true);
+	gcm_encrypt(&ctx_hw, iv, data, out_hw, CRYPTO_BYTES, tag_hw);
+	t_hw = rdcycle() - t_hw;
+	crypto_check("aes-gcm", out_sw, out_hw, CRYPTO_BYTES);
+	crypto_check("aes-gcm tag", tag_sw, tag_hw, 16);
+	crypto_print_cpb("aes-gcm", t_sw, t_hw);
+}
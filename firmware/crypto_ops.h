@@ -0,0 +1,63 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Intrinsics for the scalar crypto instructions of picorv32_pcpi_crypto
+// (ENABLE_CRYPTO). They are emitted with .insn so that no Zkn/Zbkc aware
+// toolchain is needed.
+//
+//   aes32esi   rd, rs1, rs2, bs    {bs, 5'b10001} rs2 rs1 000 rd 0110011
+//   aes32esmi  rd, rs1, rs2, bs    {bs, 5'b10011} rs2 rs1 000 rd 0110011
+//   aes32dsi   rd, rs1, rs2, bs    {bs, 5'b10101} rs2 rs1 000 rd 0110011
+//   aes32dsmi  rd, rs1, rs2, bs    {bs, 5'b10111} rs2 rs1 000 rd 0110011
+//   sha256sum0 rd, rs1             0001000 00000 rs1 001 rd 0010011
+//   sha256sum1 rd, rs1             0001000 00001 rs1 001 rd 0010011
+//   sha256sig0 rd, rs1             0001000 00010 rs1 001 rd 0010011
+//   sha256sig1 rd, rs1             0001000 00011 rs1 001 rd 0010011
+//   clmul      rd, rs1, rs2        0000101 rs2 rs1 001 rd 0110011
+//   clmulh     rd, rs1, rs2        0000101 rs2 rs1 011 rd 0110011
+
+#ifndef CRYPTO_OPS_H
+#define CRYPTO_OPS_H
+
+#include <stdint.h>
+
+// __COUNTER__ keeps the result variables of nested calls apart (-Wshadow)
+#define CRYPTO_AES32(funct7, rs1, rs2, bs) CRYPTO_AES32_(__COUNTER__, funct7, rs1, rs2, bs)
+#define CRYPTO_AES32_(n, funct7, rs1, rs2, bs) CRYPTO_AES32__(n, funct7, rs1, rs2, bs)
+#define CRYPTO_AES32__(n, funct7, rs1, rs2, bs) __extension__ ({ \
+	uint32_t __rd##n; \
+	__asm__ (".insn r 0x33, 0, %3, %0, %1, %2" : "=r"(__rd##n) : "r"(rs1), "r"(rs2), "i"(((bs) << 5) | (funct7))); \
+	__rd##n; })
+
+#define aes32esi(rs1, rs2, bs)  CRYPTO_AES32(0x11, rs1, rs2, bs)
+#define aes32esmi(rs1, rs2, bs) CRYPTO_AES32(0x13, rs1, rs2, bs)
+#define aes32dsi(rs1, rs2, bs)  CRYPTO_AES32(0x15, rs1, rs2, bs)
+#define aes32dsmi(rs1, rs2, bs) CRYPTO_AES32(0x17, rs1, rs2, bs)
+
+#define CRYPTO_SHA256(funct12, rs1) CRYPTO_SHA256_(__COUNTER__, funct12, rs1)
+#define CRYPTO_SHA256_(n, funct12, rs1) CRYPTO_SHA256__(n, funct12, rs1)
+#define CRYPTO_SHA256__(n, funct12, rs1) __extension__ ({ \
+	uint32_t __rd##n; \
+	__asm__ (".insn i 0x13, 1, %0, %1, %2" : "=r"(__rd##n) : "r"(rs1), "i"(funct12)); \
+	__rd##n; })
+
+#define sha256sum0(rs1) CRYPTO_SHA256(0x100, rs1)
+#define sha256sum1(rs1) CRYPTO_SHA256(0x101, rs1)
+#define sha256sig0(rs1) CRYPTO_SHA256(0x102, rs1)
+#define sha256sig1(rs1) CRYPTO_SHA256(0x103, rs1)
+
+#define CRYPTO_CLMUL(funct3, rs1, rs2) CRYPTO_CLMUL_(__COUNTER__, funct3, rs1, rs2)
+#define CRYPTO_CLMUL_(n, funct3, rs1, rs2) CRYPTO_CLMUL__(n, funct3, rs1, rs2)
+#define CRYPTO_CLMUL__(n, funct3, rs1, rs2) __extension__ ({ \
+	uint32_t __rd##n; \
+	__asm__ (".insn r 0x33, %3, 5, %0, %1, %2" : "=r"(__rd##n) : "r"(rs1), "r"(rs2), "i"(funct3)); \
+	__rd##n; })
+
+#define clmul(rs1, rs2)  CRYPTO_CLMUL(1, rs1, rs2)
+#define clmulh(rs1, rs2) CRYPTO_CLMUL(3, rs1, rs2)
+
+#endif
@@ -43,4 +43,10 @@ void stats(void);
 // smz_test.c
 void smz_test(void);
 
+// crypto.c
+void crypto(void);
+
+// stream.c
+void stream(void);
+
 #endif
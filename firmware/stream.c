@@ -0,0 +1,157 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Double buffered streaming of sensor frames through secure memory.
+//
+// The sensor leaves its frames in a ring of two non-secure staging frames.
+// Frame k is copied into secure buffer k & 1 while the CPU processes frame
+// k - 1 in the other buffer, one row of each at a time. Processing is the
+// sum of the absolute differences of neighbouring pixels of each row, and
+// is checked against the same sum over the staging frame.
+//
+// The buffers are at a fixed address between the firmware image and the
+// stack (stream_sections.lds keeps the image below them), so that an SMZ
+// region can cover exactly them. This only runs in firmware/stream.hex
+// (make test_verilator_stream). The testbench has no DMA master, so the
+// copy runs on the CPU and its cycles are the part of the frame time the
+// CPU does not spend processing.
+
+#include "firmware.h"
+
+#define STREAM_BUF     0x11000
+#define STREAM_ROWS    16
+#define STREAM_COLS    64
+#define STREAM_WORDS   (STREAM_ROWS * STREAM_COLS / 4)
+#define STREAM_FRAMES  8
+
+// the clock of testbench.v
+#define STREAM_CLOCK_HZ 100000000
+
+#define stream_buf(k) ((volatile uint32_t *)(STREAM_BUF + ((k) & 1) * STREAM_WORDS * 4))
+
+static uint32_t stream_staging[2][STREAM_WORDS];
+static uint32_t stream_expected[2];
+
+static inline uint32_t stream_rdcycle(void)
+{
+	uint32_t cycles;
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles));
+	return cycles;
+}
+
+static inline uint32_t stream_absdiff(uint32_t a, uint32_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static uint32_t stream_row(const volatile uint32_t *row)
+{
+	uint32_t sum = 0, last = row[0] & 0xff;
+
+	for (int i = 0; i < STREAM_COLS / 4; i++) {
+		uint32_t w = row[i];
+		for (int j = 0; j < 4; j++, w >>= 8) {
+			sum += stream_absdiff(w & 0xff, last);
+			last = w & 0xff;
+		}
+	}
+	return sum;
+}
+
+static void stream_copy_row(volatile uint32_t *dst, const uint32_t *src)
+{
+	for (int i = 0; i < STREAM_COLS / 4; i += 4) {
+		dst[i + 0] = src[i + 0];
+		dst[i + 1] = src[i + 1];
+		dst[i + 2] = src[i + 2];
+		dst[i + 3] = src[i + 3];
+	}
+}
+
+static void stream_print_fixed(uint32_t val, int decimals)
+{
+	uint32_t scale = 1;
+	for (int i = 0; i < decimals; i++)
+		scale *= 10;
+	print_dec(val / scale);
+	print_chr('.');
+	for (val %= scale; scale > 1; scale /= 10)
+		print_chr('0' + val * 10 / scale % 10);
+}
+
+void stream(void)
+{
+	uint32_t copy_cycles = 0, process_cycles = 0, errors = 0;
+	uint32_t state = 0x12345678;
+
+	print_str("stream: ");
+	print_dec(STREAM_FRAMES);
+	print_str(" frames of ");
+	print_dec(STREAM_ROWS * STREAM_COLS);
+	print_str(" bytes, buffers at 0x");
+	print_hex(STREAM_BUF, 5);
+	print_str("\n");
+
+	// the sensor side, not timed
+	for (int f = 0; f < 2; f++) {
+		stream_expected[f] = 0;
+		for (int i = 0; i < STREAM_WORDS; i++) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			stream_staging[f][i] = state;
+		}
+		for (int r = 0; r < STREAM_ROWS; r++)
+			stream_expected[f] += stream_row(&stream_staging[f][r * STREAM_COLS / 4]);
+	}
+
+	uint32_t start = stream_rdcycle();
+
+	// step k fills buffer k & 1 with frame k and drains frame k - 1
+	for (int k = 0; k <= STREAM_FRAMES; k++) {
+		volatile uint32_t *fill = stream_buf(k);
+		volatile uint32_t *drain = stream_buf(k - 1);
+		uint32_t sum = 0;
+
+		for (int r = 0; r < STREAM_ROWS; r++) {
+			int offset = r * STREAM_COLS / 4;
+			uint32_t t0 = stream_rdcycle();
+			if (k < STREAM_FRAMES)
+				stream_copy_row(fill + offset, &stream_staging[k & 1][offset]);
+			uint32_t t1 = stream_rdcycle();
+			if (k > 0)
+				sum += stream_row(drain + offset);
+			uint32_t t2 = stream_rdcycle();
+			copy_cycles += t1 - t0;
+			process_cycles += t2 - t1;
+		}
+
+		if (k > 0 && sum != stream_expected[(k - 1) & 1])
+			errors++;
+	}
+
+	uint32_t total = stream_rdcycle() - start;
+
+	print_str("stream: ");
+	print_dec(total / STREAM_FRAMES);
+	print_str(" cycles/frame (copy ");
+	print_dec(copy_cycles / STREAM_FRAMES);
+	print_str(", process ");
+	print_dec(process_cycles / STREAM_FRAMES);
+	print_str("), ");
+	stream_print_fixed((uint64_t)STREAM_FRAMES * STREAM_CLOCK_HZ * 10 / total, 1);
+	print_str(" frames/s at 100 MHz, CPU utilization ");
+	stream_print_fixed((uint64_t)process_cycles * 1000 / total, 1);
+	print_str("%\n");
+
+	if (errors) {
+		print_str("stream: ");
+		print_dec(errors);
+		print_str(" frames with a wrong checksum\n");
+		__asm__ volatile ("ebreak");
+	}
+}
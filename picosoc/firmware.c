@@ -37,6 +37,22 @@ extern uint32_t sram;
 #define reg_uart_data (*(volatile uint32_t*)0x02000008)
 #define reg_leds (*(volatile uint32_t*)0x03000000)
 
+#define reg_smz_pager_ctrl (*(volatile uint32_t*)0x02000020)
+#define reg_smz_pager_hits (*(volatile uint32_t*)0x02000024)
+#define reg_smz_pager_faults (*(volatile uint32_t*)0x02000028)
+#define reg_smz_pager_writebacks (*(volatile uint32_t*)0x0200002c)
+#define reg_smz_pager_pagein_cyc (*(volatile uint32_t*)0x02000030)
+#define reg_smz_pager_fault_cyc (*(volatile uint32_t*)0x02000034)
+#define reg_smz_pager_fault_max (*(volatile uint32_t*)0x02000038)
+#define reg_smz_pager_pagein_max (*(volatile uint32_t*)0x0200003c)
+#define smz_pager_window ((volatile uint32_t*)0x02800000)
+
+#define reg_smz_sha_ctrl (*(volatile uint32_t*)0x02000080)
+#define reg_smz_sha_addr (*(volatile uint32_t*)0x02000084)
+#define reg_smz_sha_len (*(volatile uint32_t*)0x02000088)
+#define reg_smz_sha_cycles (*(volatile uint32_t*)0x0200008c)
+#define reg_smz_sha_digest ((volatile uint32_t*)0x020000a0)
+
 // --------------------------------------------------------
 
 extern uint32_t flashio_worker_begin;
@@ -653,6 +669,223 @@ void cmd_benchmark_all()
 }
 #endif
 
+// --------------------------------------------------------
+
+uint32_t udiv32(uint32_t num, uint32_t den)
+{
+	// shift-subtract, so this also links on targets without ENABLE_DIV
+	uint32_t quot = 0, rem = 0;
+
+	if (den == 0)
+		return 0;
+
+	for (int i = 31; i >= 0; i--) {
+		rem = (rem << 1) | ((num >> i) & 1);
+		if (rem >= den) {
+			rem -= den;
+			quot |= 1 << i;
+		}
+	}
+
+	return quot;
+}
+
+void cmd_smz_pager()
+{
+	uint32_t config = reg_smz_pager_ctrl;
+
+	if (config == 0) {
+		print("SMZ pager not present\n");
+		return;
+	}
+
+	int frames = config >> 24;
+	int vpages = (config >> 16) & 255;
+	int page_words = (config & 0xffff) / 4;
+	int page_shift = 0;
+
+	while ((1 << page_shift) < page_words)
+		page_shift++;
+
+	// dataset is four times the frame RAM, hot set fits into it
+	int pages = 4*frames < vpages ? 4*frames : vpages;
+	int hot_pages = frames - 1;
+	int errors = 0;
+
+	reg_smz_pager_ctrl = 3;
+
+	for (int p = 0; p < pages; p++)
+		for (int w = 0; w < page_words; w++)
+			smz_pager_window[(p << page_shift) + w] = (p << 16) | w;
+
+	for (int rep = 0; rep < 16; rep++)
+		for (int p = 0; p < hot_pages; p++)
+			for (int w = 0; w < page_words; w += 4)
+				if (smz_pager_window[(p << page_shift) + w] != ((p << 16) | w))
+					errors++;
+
+	for (int rep = 0; rep < 2; rep++)
+		for (int p = 0; p < pages; p++)
+			for (int w = 0; w < page_words; w += 16)
+				if (smz_pager_window[(p << page_shift) + w] != ((p << 16) | w))
+					errors++;
+
+	uint32_t hits = reg_smz_pager_hits;
+	uint32_t faults = reg_smz_pager_faults;
+
+	print("SMZ pager: ");
+	print_dec(frames);
+	print(" frames, ");
+	print_dec(pages);
+	print(" pages of ");
+	print_dec(4*page_words);
+	print(" bytes\n");
+
+	print("  hits           : ");
+	print_hex(hits, 8);
+	putchar('\n');
+
+	print("  faults         : ");
+	print_hex(faults, 8);
+	putchar('\n');
+
+	print("  writebacks     : ");
+	print_hex(reg_smz_pager_writebacks, 8);
+	putchar('\n');
+
+	print("  hit rate       : ");
+	print_dec(udiv32(100*hits, hits + faults));
+	print("%\n");
+
+	print("  avg page-in    : ");
+	print_hex(udiv32(reg_smz_pager_pagein_cyc, faults), 8);
+	print(" cycles\n");
+
+	print("  max page-in    : ");
+	print_hex(reg_smz_pager_pagein_max, 8);
+	print(" cycles\n");
+
+	print("  avg fault      : ");
+	print_hex(udiv32(reg_smz_pager_fault_cyc, faults), 8);
+	print(" cycles\n");
+
+	print("  max fault      : ");
+	print_hex(reg_smz_pager_fault_max, 8);
+	print(" cycles\n");
+
+	print(errors ? "  data check FAILED\n" : "  data check passed\n");
+}
+
+static uint32_t sha256_ror(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+// software reference for the engine: SHA-256 of len bytes (multiple of 4)
+// at a word aligned address, bytes in address order
+void sha256_words(volatile uint32_t *p, uint32_t len, uint32_t *h)
+{
+	static const uint32_t k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+	static const uint32_t iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	uint32_t words = len / 4, total = ((words + 2) / 16 + 1) * 16;
+	uint32_t w[64];
+
+	for (int i = 0; i < 8; i++)
+		h[i] = iv[i];
+
+	for (uint32_t blk = 0; blk < total; blk += 16) {
+		for (int i = 0; i < 16; i++) {
+			uint32_t idx = blk + i, x;
+			if (idx < words) {
+				x = p[idx];
+				x = (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+			} else if (idx == words)
+				x = 0x80000000;
+			else if (idx == total - 2)
+				x = len >> 29;
+			else if (idx == total - 1)
+				x = len << 3;
+			else
+				x = 0;
+			w[i] = x;
+		}
+		for (int i = 16; i < 64; i++)
+			w[i] = (sha256_ror(w[i-2], 17) ^ sha256_ror(w[i-2], 19) ^ (w[i-2] >> 10)) + w[i-7] +
+					(sha256_ror(w[i-15], 7) ^ sha256_ror(w[i-15], 18) ^ (w[i-15] >> 3)) + w[i-16];
+
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+		for (int i = 0; i < 64; i++) {
+			uint32_t t1 = hh + (sha256_ror(e, 6) ^ sha256_ror(e, 11) ^ sha256_ror(e, 25)) +
+					((e & f) ^ (~e & g)) + k[i] + w[i];
+			uint32_t t2 = (sha256_ror(a, 2) ^ sha256_ror(a, 13) ^ sha256_ror(a, 22)) +
+					((a & b) ^ (a & c) ^ (b & c));
+			hh = g, g = f, f = e, e = d + t1;
+			d = c, c = b, b = a, a = t1 + t2;
+		}
+		h[0] += a, h[1] += b, h[2] += c, h[3] += d;
+		h[4] += e, h[5] += f, h[6] += g, h[7] += hh;
+	}
+}
+
+void cmd_smz_measure()
+{
+	// hash the first kB of the secure window, which is paged and encrypted
+	uint32_t len = 1024, digest[8];
+	uint32_t cycles_begin, cycles_end;
+	int errors = 0;
+
+	reg_smz_sha_addr = (uint32_t)smz_pager_window;
+	if (reg_smz_sha_addr != (uint32_t)smz_pager_window) {
+		print("SMZ SHA-256 engine not present\n");
+		return;
+	}
+
+	for (uint32_t i = 0; i < len / 4; i++)
+		smz_pager_window[i] = i * 0x9e3779b9;
+
+	reg_smz_sha_len = len;
+	reg_smz_sha_ctrl = 3;
+	while (reg_smz_sha_ctrl & 1) { }
+
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles_begin));
+	sha256_words(smz_pager_window, len, digest);
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles_end));
+
+	print("SMZ SHA-256 of 0x");
+	print_hex((uint32_t)smz_pager_window, 8);
+	print(", ");
+	print_dec(len);
+	print(" bytes:\n  ");
+	for (int i = 0; i < 8; i++) {
+		print_hex(reg_smz_sha_digest[i], 8);
+		if (reg_smz_sha_digest[i] != digest[i])
+			errors++;
+	}
+	putchar('\n');
+
+	print("  engine cycles  : ");
+	print_hex(reg_smz_sha_cycles, 8);
+	putchar('\n');
+
+	print("  software cycles: ");
+	print_hex(cycles_end - cycles_begin, 8);
+	putchar('\n');
+
+	print(errors ? "  digest check FAILED\n" : "  digest check passed\n");
+	reg_smz_sha_ctrl = 2;
+}
+
 void cmd_echo()
 {
 	print("Return to menu by sending '!'\n\n");
@@ -710,6 +943,8 @@ void main()
 		print("   [9] Run simplistic benchmark\n");
 		print("   [0] Benchmark all configs\n");
 		print("   [M] Run Memtest\n");
+		print("   [P] Run SMZ pager benchmark\n");
+		print("   [H] Measure SMZ window with SHA-256 engine\n");
 		print("   [S] Print SPI state\n");
 		print("   [e] Echo UART\n");
 		print("\n");
@@ -754,6 +989,12 @@ void main()
 			case 'M':
 				cmd_memtest();
 				break;
+			case 'P':
+				cmd_smz_pager();
+				break;
+			case 'H':
+				cmd_smz_measure();
+				break;
 			case 'S':
 				cmd_print_spi_state();
 				break;
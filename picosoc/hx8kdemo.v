@@ -90,7 +90,10 @@ module hx8kdemo (
 		end
 	end
 
-	picosoc soc (
+	picosoc #(
+		.ENABLE_SMZ_PAGER(1),
+		.ENABLE_SMZ_SHA(1)
+	) soc (
 		.clk          (clk         ),
 		.resetn       (resetn      ),
 
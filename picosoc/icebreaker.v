@@ -46,6 +46,9 @@ module icebreaker (
 	inout  flash_io3
 );
 	parameter integer MEM_WORDS = 32768;
+	parameter [0:0] ENABLE_SMZ_BOOT = 0;
+	parameter [7:0] SMZ_BOOT_FLASH_CFG = 8'h 00;
+	parameter [0:0] ENABLE_SMZ_PAGER = 0;
 
 	reg [5:0] reset_cnt = 0;
 	wire resetn = &reset_cnt;
@@ -111,6 +114,10 @@ module icebreaker (
 		.ENABLE_MUL(0),
 		.ENABLE_DIV(0),
 		.ENABLE_FAST_MUL(1),
+		.ENABLE_SMZ_BOOT(ENABLE_SMZ_BOOT),
+		.ENABLE_SMZ_PAGER(ENABLE_SMZ_PAGER),
+		.SMZ_BOOT_FLASH_CFG(SMZ_BOOT_FLASH_CFG),
+		.PROGADDR_RESET(ENABLE_SMZ_BOOT ? 32'h 0000_0000 : 32'h 0010_0000),
 		.MEM_WORDS(MEM_WORDS)
 	) soc (
 		.clk          (clk         ),
@@ -76,15 +76,23 @@ module picosoc (
 	parameter [0:0] ENABLE_COMPRESSED = 1;
 	parameter [0:0] ENABLE_COUNTERS = 1;
 	parameter [0:0] ENABLE_IRQ_QREGS = 0;
+	parameter [0:0] ENABLE_SMZ_PAGER = 0;
+	parameter [0:0] ENABLE_SMZ_BOOT = 0;
+	parameter [0:0] ENABLE_SMZ_SHA = 0;
 
 	parameter integer MEM_WORDS = 256;
 	parameter [31:0] STACKADDR = (4*MEM_WORDS);       // end of memory
 	parameter [31:0] PROGADDR_RESET = 32'h 0010_0000; // 1 MB into flash
 	parameter [31:0] PROGADDR_IRQ = 32'h 0000_0000;
 
+	parameter [23:0] SMZ_BOOT_IMAGE_ADDR = 24'h 10_0000;
+	parameter [127:0] SMZ_BOOT_KEY = 128'h 0f1e2d3c_4b5a6978_8796a5b4_c3d2e1f0;
+	parameter [7:0] SMZ_BOOT_FLASH_CFG = 8'h 00;
+
 	reg [31:0] irq;
 	wire irq_stall = 0;
 	wire irq_uart = 0;
+	wire irq_smz_sha;
 
 	always @* begin
 		irq = 0;
@@ -93,17 +101,47 @@ module picosoc (
 		irq[5] = irq_5;
 		irq[6] = irq_6;
 		irq[7] = irq_7;
+		irq[8] = irq_smz_sha;
 	end
 
-	wire mem_valid;
+	wire cpu_mem_valid;
 	wire mem_instr;
+	wire cpu_mem_ready;
+	wire [31:0] cpu_mem_addr;
+	wire [31:0] cpu_mem_wdata;
+	wire [3:0] cpu_mem_wstrb;
+
+	wire smz_sha_mem_valid;
+	wire smz_sha_mem_ready;
+	wire [31:0] smz_sha_mem_addr;
+
+	wire mem_valid;
 	wire mem_ready;
 	wire [31:0] mem_addr;
 	wire [31:0] mem_wdata;
 	wire [3:0] mem_wstrb;
 	wire [31:0] mem_rdata;
 
+	// The SHA-256 engine is a second (read only) bus master. Ownership only
+	// changes between transfers; when both masters are waiting they alternate.
+	reg smz_sha_grant;
+
+	always @(posedge clk) begin
+		if (!resetn || !ENABLE_SMZ_SHA)
+			smz_sha_grant <= 0;
+		else if (smz_sha_grant ? !smz_sha_mem_valid || mem_ready : !cpu_mem_valid || mem_ready)
+			smz_sha_grant <= smz_sha_mem_valid && !(smz_sha_grant && cpu_mem_valid);
+	end
+
+	assign mem_valid = smz_sha_grant ? smz_sha_mem_valid : cpu_mem_valid;
+	assign mem_addr = smz_sha_grant ? smz_sha_mem_addr : cpu_mem_addr;
+	assign mem_wdata = cpu_mem_wdata;
+	assign mem_wstrb = smz_sha_grant ? 4'b 0000 : cpu_mem_wstrb;
+	assign cpu_mem_ready = mem_ready && !smz_sha_grant;
+	assign smz_sha_mem_ready = mem_ready && smz_sha_grant;
+
 	wire spimem_ready;
+	wire spimem_xfer_ready;
 	wire [31:0] spimem_rdata;
 
 	reg ram_ready;
@@ -124,12 +162,53 @@ module picosoc (
 	wire [31:0] simpleuart_reg_dat_do;
 	wire        simpleuart_reg_dat_wait;
 
+	wire        smz_pager_reg_sel = ENABLE_SMZ_PAGER && mem_valid && (mem_addr[31:5] == 27'h 010_0001);
+	wire [31:0] smz_pager_reg_do;
+
+	// the window is only as large as the virtual pages of the pager, the
+	// addresses above it are unmapped like the rest of 0x02xx_xxxx
+	localparam integer SMZ_PAGER_PAGE_WORDS = 64;
+	localparam integer SMZ_PAGER_VPAGES = 64;
+	localparam [31:0] SMZ_PAGER_BASE = 32'h 0280_0000;
+	localparam [31:0] SMZ_PAGER_SIZE = 4 * SMZ_PAGER_PAGE_WORDS * SMZ_PAGER_VPAGES;
+
+	wire        smz_pager_sel = ENABLE_SMZ_PAGER && mem_valid && mem_addr >= SMZ_PAGER_BASE &&
+			mem_addr < SMZ_PAGER_BASE + SMZ_PAGER_SIZE;
+	wire        smz_pager_ready;
+	wire [31:0] smz_pager_rdata;
+
+	wire        smz_pager_flash_valid;
+	wire [23:0] smz_pager_flash_addr;
+	wire        smz_pager_cfg_busy;
+	wire [ 3:0] smz_pager_cfg_we;
+	wire [31:0] smz_pager_cfg_di;
+
+	wire        smz_boot_reg_sel = ENABLE_SMZ_BOOT && mem_valid && (mem_addr[31:4] == 28'h 020_0004);
+	wire [31:0] smz_boot_reg_do;
+
+	wire        smz_boot_done;
+	wire        smz_boot_ram_we;
+	wire [21:0] smz_boot_ram_addr;
+	wire [31:0] smz_boot_ram_wdata;
+	wire        smz_boot_flash_valid;
+	wire [23:0] smz_boot_flash_addr;
+	wire [ 3:0] smz_boot_cfg_we;
+	wire [31:0] smz_boot_cfg_di;
+
+	wire        smz_sha_reg_sel = ENABLE_SMZ_SHA && mem_valid && (mem_addr[31:6] == 26'h 080_0002);
+	wire [31:0] smz_sha_reg_do;
+
+	assign spimem_ready = spimem_xfer_ready && !smz_pager_flash_valid && !smz_boot_flash_valid;
+
 	assign mem_ready = (iomem_valid && iomem_ready) || spimem_ready || ram_ready || spimemio_cfgreg_sel ||
-			simpleuart_reg_div_sel || (simpleuart_reg_dat_sel && !simpleuart_reg_dat_wait);
+			simpleuart_reg_div_sel || (simpleuart_reg_dat_sel && !simpleuart_reg_dat_wait) ||
+			smz_pager_reg_sel || smz_pager_ready || smz_boot_reg_sel || smz_sha_reg_sel;
 
 	assign mem_rdata = (iomem_valid && iomem_ready) ? iomem_rdata : spimem_ready ? spimem_rdata : ram_ready ? ram_rdata :
 			spimemio_cfgreg_sel ? spimemio_cfgreg_do : simpleuart_reg_div_sel ? simpleuart_reg_div_do :
-			simpleuart_reg_dat_sel ? simpleuart_reg_dat_do : 32'h 0000_0000;
+			simpleuart_reg_dat_sel ? simpleuart_reg_dat_do : smz_pager_reg_sel ? smz_pager_reg_do :
+			smz_pager_ready ? smz_pager_rdata : smz_boot_reg_sel ? smz_boot_reg_do :
+			smz_sha_reg_sel ? smz_sha_reg_do : 32'h 0000_0000;
 
 	picorv32 #(
 		.STACKADDR(STACKADDR),
@@ -145,13 +224,13 @@ module picosoc (
 		.ENABLE_IRQ_QREGS(ENABLE_IRQ_QREGS)
 	) cpu (
 		.clk         (clk        ),
-		.resetn      (resetn     ),
-		.mem_valid   (mem_valid  ),
+		.resetn      (resetn && smz_boot_done),
+		.mem_valid   (cpu_mem_valid),
 		.mem_instr   (mem_instr  ),
-		.mem_ready   (mem_ready  ),
-		.mem_addr    (mem_addr   ),
-		.mem_wdata   (mem_wdata  ),
-		.mem_wstrb   (mem_wstrb  ),
+		.mem_ready   (cpu_mem_ready),
+		.mem_addr    (cpu_mem_addr),
+		.mem_wdata   (cpu_mem_wdata),
+		.mem_wstrb   (cpu_mem_wstrb),
 		.mem_rdata   (mem_rdata  ),
 		.irq         (irq        )
 	);
@@ -159,9 +238,9 @@ module picosoc (
 	spimemio spimemio (
 		.clk    (clk),
 		.resetn (resetn),
-		.valid  (mem_valid && mem_addr >= 4*MEM_WORDS && mem_addr < 32'h 0200_0000),
-		.ready  (spimem_ready),
-		.addr   (mem_addr[23:0]),
+		.valid  (smz_boot_flash_valid || smz_pager_flash_valid || (mem_valid && mem_addr >= 4*MEM_WORDS && mem_addr < 32'h 0200_0000)),
+		.ready  (spimem_xfer_ready),
+		.addr   (smz_boot_flash_valid ? smz_boot_flash_addr : smz_pager_flash_valid ? smz_pager_flash_addr : mem_addr[23:0]),
 		.rdata  (spimem_rdata),
 
 		.flash_csb    (flash_csb   ),
@@ -182,8 +261,8 @@ module picosoc (
 		.flash_io2_di (flash_io2_di),
 		.flash_io3_di (flash_io3_di),
 
-		.cfgreg_we(spimemio_cfgreg_sel ? mem_wstrb : 4'b 0000),
-		.cfgreg_di(mem_wdata),
+		.cfgreg_we(!smz_boot_done ? smz_boot_cfg_we : smz_pager_cfg_busy ? smz_pager_cfg_we : spimemio_cfgreg_sel ? mem_wstrb : 4'b 0000),
+		.cfgreg_di(!smz_boot_done ? smz_boot_cfg_di : smz_pager_cfg_busy ? smz_pager_cfg_di : mem_wdata),
 		.cfgreg_do(spimemio_cfgreg_do)
 	);
 
@@ -205,6 +284,122 @@ module picosoc (
 		.reg_dat_wait(simpleuart_reg_dat_wait)
 	);
 
+	generate if (ENABLE_SMZ_PAGER) begin
+		// The window at 0x0280_0000 is always secure. The SMZ keystream is
+		// bound to the window address, so frames can hold any page.
+		wire [31:0] smz_pager_wdata;
+		wire [31:0] smz_pager_cipher_rdata;
+
+		smz_layer smz_layer (
+			.clk          (clk                     ),
+			.resetn       (resetn                  ),
+			.cpu_mem_valid(smz_pager_sel           ),
+			.cpu_mem_addr (mem_addr                ),
+			.cpu_mem_wdata(mem_wdata               ),
+			.cpu_mem_wstrb(mem_wstrb               ),
+			.mem_wdata    (smz_pager_wdata         ),
+			.mem_rdata    (smz_pager_cipher_rdata  ),
+			.smz_base     (SMZ_PAGER_BASE          ),
+			.smz_size     (SMZ_PAGER_SIZE          ),
+			.smz_enable   (1'b 1                   ),
+			.cpu_mem_rdata(smz_pager_rdata         )
+		);
+
+		smz_pager #(
+			.PAGE_WORDS(SMZ_PAGER_PAGE_WORDS),
+			.VPAGES    (SMZ_PAGER_VPAGES    )
+		) smz_pager (
+			.clk           (clk                   ),
+			.resetn        (resetn                ),
+			.valid         (smz_pager_sel         ),
+			.ready         (smz_pager_ready       ),
+			.wstrb         (mem_wstrb             ),
+			.addr          (mem_addr[23:0]        ),
+			.wdata         (smz_pager_wdata       ),
+			.rdata         (smz_pager_cipher_rdata),
+			.reg_addr      (mem_addr[4:2]         ),
+			.reg_we        (smz_pager_reg_sel ? mem_wstrb : 4'b 0000),
+			.reg_di        (mem_wdata             ),
+			.reg_do        (smz_pager_reg_do      ),
+			.flash_valid   (smz_pager_flash_valid ),
+			.flash_ready   (spimem_xfer_ready     ),
+			.flash_addr    (smz_pager_flash_addr  ),
+			.flash_rdata   (spimem_rdata          ),
+			.flash_cfg_busy(smz_pager_cfg_busy    ),
+			.flash_cfg_we  (smz_pager_cfg_we      ),
+			.flash_cfg_di  (smz_pager_cfg_di      ),
+			.flash_cfg_do  (spimemio_cfgreg_do    )
+		);
+	end else begin
+		assign smz_pager_ready = 0;
+		assign smz_pager_rdata = 0;
+		assign smz_pager_reg_do = 0;
+		assign smz_pager_flash_valid = 0;
+		assign smz_pager_flash_addr = 0;
+		assign smz_pager_cfg_busy = 0;
+		assign smz_pager_cfg_we = 0;
+		assign smz_pager_cfg_di = 0;
+	end endgenerate
+
+	generate if (ENABLE_SMZ_BOOT) begin
+		// Decrypts the flash image into SRAM while the CPU is held in reset,
+		// so PROGADDR_RESET should point at the image load address.
+		smz_bootload #(
+			.IMAGE_ADDR(SMZ_BOOT_IMAGE_ADDR),
+			.KEY       (SMZ_BOOT_KEY       ),
+			.FLASH_CFG (SMZ_BOOT_FLASH_CFG ),
+			.MEM_WORDS (MEM_WORDS          )
+		) smz_bootload (
+			.clk         (clk                 ),
+			.resetn      (resetn              ),
+			.done        (smz_boot_done       ),
+			.ram_we      (smz_boot_ram_we     ),
+			.ram_addr    (smz_boot_ram_addr   ),
+			.ram_wdata   (smz_boot_ram_wdata  ),
+			.flash_valid (smz_boot_flash_valid),
+			.flash_ready (spimem_xfer_ready   ),
+			.flash_addr  (smz_boot_flash_addr ),
+			.flash_rdata (spimem_rdata        ),
+			.flash_cfg_we(smz_boot_cfg_we     ),
+			.flash_cfg_di(smz_boot_cfg_di     ),
+			.reg_addr    (mem_addr[3:2]       ),
+			.reg_do      (smz_boot_reg_do     )
+		);
+	end else begin
+		assign smz_boot_done = 1;
+		assign smz_boot_ram_we = 0;
+		assign smz_boot_ram_addr = 0;
+		assign smz_boot_ram_wdata = 0;
+		assign smz_boot_flash_valid = 0;
+		assign smz_boot_flash_addr = 0;
+		assign smz_boot_cfg_we = 0;
+		assign smz_boot_cfg_di = 0;
+		assign smz_boot_reg_do = 0;
+	end endgenerate
+
+	generate if (ENABLE_SMZ_SHA) begin
+		// Measures any bus range, reads from the SMZ window are decrypted by
+		// the pager's smz_layer on the way.
+		smz_sha256 smz_sha256 (
+			.clk      (clk              ),
+			.resetn   (resetn           ),
+			.irq      (irq_smz_sha      ),
+			.mem_valid(smz_sha_mem_valid),
+			.mem_ready(smz_sha_mem_ready),
+			.mem_addr (smz_sha_mem_addr ),
+			.mem_rdata(mem_rdata        ),
+			.reg_addr (mem_addr[5:2]    ),
+			.reg_we   (smz_sha_reg_sel ? mem_wstrb : 4'b 0000),
+			.reg_di   (mem_wdata        ),
+			.reg_do   (smz_sha_reg_do   )
+		);
+	end else begin
+		assign irq_smz_sha = 0;
+		assign smz_sha_mem_valid = 0;
+		assign smz_sha_mem_addr = 0;
+		assign smz_sha_reg_do = 0;
+	end endgenerate
+
 	always @(posedge clk)
 		ram_ready <= mem_valid && !mem_ready && mem_addr < 4*MEM_WORDS;
 
@@ -212,9 +407,9 @@ module picosoc (
 		.WORDS(MEM_WORDS)
 	) memory (
 		.clk(clk),
-		.wen((mem_valid && !mem_ready && mem_addr < 4*MEM_WORDS) ? mem_wstrb : 4'b0),
-		.addr(mem_addr[23:2]),
-		.wdata(mem_wdata),
+		.wen(smz_boot_ram_we ? 4'b 1111 : (mem_valid && !mem_ready && mem_addr < 4*MEM_WORDS) ? mem_wstrb : 4'b0),
+		.addr(smz_boot_ram_we ? smz_boot_ram_addr : mem_addr[23:2]),
+		.wdata(smz_boot_ram_we ? smz_boot_ram_wdata : mem_wdata),
 		.rdata(ram_rdata)
 	);
 endmodule
@@ -0,0 +1,218 @@
+/*
+ *  PicoSoC - A simple example SoC using PicoRV32
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+//
+// SMZ secure boot loader
+//
+// Holds the CPU in reset while it streams an encrypted image from SPI flash
+// into on-chip SRAM. The image is produced by smz_mkimage.py:
+//
+//   word 0     magic "SMZB" (32'h 425a_4d53)
+//   word 1     number of payload words
+//   word 2     SRAM load address
+//   word 3     nonce
+//   word 4..   payload[i] ^ smz_boot_ks(key, nonce, i)
+//
+// The keystream only depends on the word index, so a four stage pipeline
+// (one ARX round per stage) runs ahead of the flash and every payload word is
+// decrypted and written in the cycle spimemio delivers it. Boot time is thus
+// the flash streaming time plus a few cycles.
+//
+// If FLASH_CFG is non-zero it is written to bits 23:16 of the spimemio config
+// register before streaming (e.g. 8'h 77 for QSPI DDR with continuous read).
+// The CPU is released even if the header is rejected; firmware should check
+// STATUS before trusting the contents of SRAM.
+//
+// Status registers (reg_addr is the word index):
+//
+//   0  STATUS   bit 0 done, bit 1 bad magic, bit 2 image too large
+//   1  CYCLES   cycles from reset release to CPU release
+//   2  WORDS    payload words loaded
+//
+
+module smz_bootload #(
+	parameter [23:0] IMAGE_ADDR = 24'h 10_0000,
+	parameter [127:0] KEY = 128'h 0f1e2d3c_4b5a6978_8796a5b4_c3d2e1f0,
+	parameter [7:0] FLASH_CFG = 8'h 00,
+	parameter integer MEM_WORDS = 256
+) (
+	input clk,
+	input resetn,
+
+	output            done,
+
+	// SRAM write port
+	output            ram_we,
+	output     [21:0] ram_addr,
+	output     [31:0] ram_wdata,
+
+	// flash read port (spimemio)
+	output            flash_valid,
+	input             flash_ready,
+	output     [23:0] flash_addr,
+	input      [31:0] flash_rdata,
+
+	// spimemio config register
+	output     [ 3:0] flash_cfg_we,
+	output     [31:0] flash_cfg_di,
+
+	input      [ 1:0] reg_addr,
+	output reg [31:0] reg_do
+);
+	localparam [31:0] MAGIC = 32'h 425a_4d53;
+
+	localparam [2:0] S_CFG  = 0;
+	localparam [2:0] S_HDR  = 1;
+	localparam [2:0] S_LOAD = 2;
+	localparam [2:0] S_DONE = 3;
+
+	reg [2:0] state;
+	reg [1:0] hdr_idx;
+	reg [31:0] hdr_words;
+	reg [31:0] hdr_load;
+	reg [31:0] hdr_nonce;
+	reg [31:0] load_idx;
+	reg [23:0] fetch_addr;
+	reg [31:0] cycles;
+	reg bad_magic;
+	reg too_large;
+
+	reg [31:0] ks_data [0:3];
+	reg [3:0] ks_valid;
+	reg [31:0] ks_idx;
+
+	assign done = state == S_DONE;
+	assign flash_valid = state == S_HDR || (state == S_LOAD && ks_valid[3]);
+	assign flash_addr = fetch_addr;
+	assign flash_cfg_we = state == S_CFG && FLASH_CFG ? 4'b 0100 : 4'b 0000;
+	assign flash_cfg_di = {8'h 00, FLASH_CFG, 16'h 0000};
+
+	// keystream pipeline, one ARX round per stage
+
+	function [31:0] ks_round;
+		input [31:0] x;
+		input [31:0] k;
+		reg [31:0] t;
+		begin
+			t = x + k;
+			ks_round = t ^ {t[24:0], t[31:25]} ^ {t[12:0], t[31:13]};
+		end
+	endfunction
+
+	// the flash request is only raised once a keystream word is ready, so the
+	// payload word can be decrypted in the cycle it is delivered
+	wire ks_take = state == S_LOAD && flash_ready;
+	wire [3:0] ks_adv;
+
+	assign ks_adv[3] = !ks_valid[3] || ks_take;
+	assign ks_adv[2] = !ks_valid[2] || ks_adv[3];
+	assign ks_adv[1] = !ks_valid[1] || ks_adv[2];
+	assign ks_adv[0] = !ks_valid[0] || ks_adv[1];
+
+	wire ks_run = state == S_HDR ? hdr_idx == 3 && flash_ready : state == S_LOAD;
+
+	always @(posedge clk) begin
+		if (ks_adv[3]) begin
+			ks_data[3] <= ks_round(ks_data[2], KEY[31:0]);
+			ks_valid[3] <= ks_valid[2];
+		end
+		if (ks_adv[2]) begin
+			ks_data[2] <= ks_round(ks_data[1], KEY[63:32]);
+			ks_valid[2] <= ks_valid[1];
+		end
+		if (ks_adv[1]) begin
+			ks_data[1] <= ks_round(ks_data[0], KEY[95:64]);
+			ks_valid[1] <= ks_valid[0];
+		end
+		if (ks_adv[0]) begin
+			// the nonce arrives as the last header word, so bypass it in that cycle
+			ks_data[0] <= ks_round((state == S_HDR ? flash_rdata : hdr_nonce) ^ ks_idx, KEY[127:96]);
+			ks_valid[0] <= ks_run;
+			if (ks_run)
+				ks_idx <= ks_idx + 1;
+		end
+		if (!resetn || state == S_CFG) begin
+			ks_valid <= 0;
+			ks_idx <= 0;
+		end
+	end
+
+	assign ram_we = ks_take;
+	assign ram_addr = (hdr_load >> 2) + load_idx;
+	assign ram_wdata = flash_rdata ^ ks_data[3];
+
+	// load address and size checked separately, the 32 bit sum can wrap
+	wire hdr_fits = (hdr_load >> 2) <= MEM_WORDS && hdr_words <= MEM_WORDS - (hdr_load >> 2);
+
+	always @(posedge clk) begin
+		if (state != S_DONE)
+			cycles <= cycles + 1;
+
+		case (state)
+			S_CFG: begin
+				fetch_addr <= IMAGE_ADDR;
+				hdr_idx <= 0;
+				state <= S_HDR;
+			end
+			S_HDR: begin
+				if (flash_ready) begin
+					fetch_addr <= fetch_addr + 4;
+					hdr_idx <= hdr_idx + 1;
+					case (hdr_idx)
+						0: bad_magic <= flash_rdata != MAGIC;
+						1: hdr_words <= flash_rdata;
+						2: hdr_load <= flash_rdata;
+						3: begin
+							hdr_nonce <= flash_rdata;
+							too_large <= !hdr_fits;
+							state <= S_LOAD;
+							if (bad_magic || !hdr_fits || hdr_words == 0)
+								state <= S_DONE;
+						end
+					endcase
+				end
+			end
+			S_LOAD: begin
+				if (flash_ready) begin
+					fetch_addr <= fetch_addr + 4;
+					load_idx <= load_idx + 1;
+					if (load_idx == hdr_words - 1)
+						state <= S_DONE;
+				end
+			end
+		endcase
+
+		if (!resetn) begin
+			state <= S_CFG;
+			load_idx <= 0;
+			cycles <= 0;
+			bad_magic <= 0;
+			too_large <= 0;
+			hdr_words <= 0;
+			hdr_load <= 0;
+		end
+	end
+
+	always @* begin
+		case (reg_addr)
+			0: reg_do = {29'b 0, too_large, bad_magic, done};
+			1: reg_do = cycles;
+			2: reg_do = load_idx;
+			default: reg_do = 0;
+		endcase
+	end
+endmodule
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Size and keystream throughput of the SMZ cipher options on iCE40.
+#
+#   smz_cipher_report.py [--yosys YOSYS] [--dsp] [--rounds N] [--line-words N]
+#
+# Synthesizes smz_layer.v and picorv32_smz with each CIPHER setting with
+# synth_ice40 and prints LUTs, flip-flops and the keystream bits per engine
+# clock, for a whole line read in order (seq) and for one word at a random
+# offset of a new line (rnd), and the same per 1000 LUTs. The throughput
+# columns follow from the cipher structure (rounds per word, Trivium
+# initialization per line), not from a simulation. Clock frequency is not
+# included, run nextpnr on a full design for that.
+#
+
+import argparse, re, subprocess, sys, os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCES = [os.path.join(HERE, "..", "picorv32.v"), os.path.join(HERE, "..", "smz_layer.v")]
+
+TRIVIUM_INIT_ROUNDS = 1152 // 32
+
+# name: (top module, parameters, sequential bits/clk, random bits/clk)
+def variants(rounds, line_words):
+    # load, initialization, then one round per word up to the one wanted
+    trivium_line = 1 + TRIVIUM_INIT_ROUNDS + line_words
+    trivium_word = 1 + TRIVIUM_INIT_ROUNDS + 1 + (line_words - 1) / 2.0
+    return [
+        ("smz_layer (addr XOR)", "smz_layer", {}, 32.0, 32.0),
+        ("picorv32_smz key XOR", "picorv32_smz", {"CIPHER": 0}, 32.0, 32.0),
+        ("picorv32_smz ARX x%d" % rounds, "picorv32_smz", {"CIPHER": 1, "CIPHER_ROUNDS": rounds},
+                32.0 / rounds, 32.0 / rounds),
+        ("picorv32_smz Trivium", "picorv32_smz", {"CIPHER": 2, "CIPHER_LINE_WORDS": line_words},
+                32.0 * line_words / trivium_line, 32.0 / trivium_word),
+    ]
+
+def synth(yosys, top, params, dsp):
+    script = "".join("read_verilog %s; " % f for f in SOURCES)
+    script += "".join("chparam -set %s %d %s; " % (k, v, top) for k, v in sorted(params.items()))
+    script += "synth_ice40 %s-top %s; stat" % ("-dsp " if dsp else "", top)
+    try:
+        out = subprocess.run([yosys, "-p", script], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                universal_newlines=True).stdout
+    except OSError as e:
+        sys.exit("smz_cipher_report: %s: %s" % (yosys, e))
+    # only the last statistics block, and both the old and new stat layout
+    stat = out.split("Printing statistics.")[-1]
+    cells = {}
+    for m in re.finditer(r"^\s+(?:(\d+)\s+(?:[\d.]+\s+)?)?(SB_\w+)(?:\s+(\d+))?\s*$", stat, re.M):
+        cells[m.group(2)] = int(m.group(1) or m.group(3) or 0)
+    if "SB_LUT4" not in cells:
+        sys.stdout.write(out)
+        sys.exit("smz_cipher_report: no SB_LUT4 count for %s" % top)
+    ffs = sum(n for c, n in cells.items() if c.startswith("SB_DFF"))
+    return cells["SB_LUT4"], ffs
+
+parser = argparse.ArgumentParser(description="SMZ cipher size and throughput on iCE40")
+parser.add_argument("--yosys", default="yosys")
+parser.add_argument("--dsp", action="store_true", help="synth_ice40 -dsp (UP5K)")
+parser.add_argument("--rounds", type=int, default=4, help="CIPHER_ROUNDS of the ARX cipher")
+parser.add_argument("--line-words", type=int, default=8, help="CIPHER_LINE_WORDS of Trivium")
+args = parser.parse_args()
+
+print("%-24s %6s %6s %10s %10s %12s %12s" % ("cipher", "LUTs", "FFs", "seq b/clk", "rnd b/clk",
+        "seq b/kLUT", "rnd b/kLUT"))
+for name, top, params, seq, rnd in variants(args.rounds, args.line_words):
+    luts, ffs = synth(args.yosys, top, params, args.dsp)
+    print("%-24s %6d %6d %10.2f %10.2f %12.1f %12.1f" % (name, luts, ffs, seq, rnd,
+            1000.0 * seq / luts, 1000.0 * rnd / luts))
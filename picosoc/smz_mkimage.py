@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# Build an encrypted flash image for the SMZ boot loader (smz_bootload.v).
+#
+#   smz_mkimage.py [options] payload.bin image.hex
+#
+# The payload is a raw binary linked for SRAM. The output is either a verilog
+# hex file with an "@" offset for spiflash.v, or (for *.bin) a raw binary to
+# be written with "iceprog -o <offset>".
+#
+
+import argparse
+import struct
+
+MAGIC = 0x425a4d53
+
+def rotl(x, n):
+    return ((x << n) | (x >> (32 - n))) & 0xffffffff
+
+def ks_round(x, k):
+    t = (x + k) & 0xffffffff
+    return t ^ rotl(t, 7) ^ rotl(t, 19)
+
+def keystream(key, nonce, i):
+    x = nonce ^ i
+    for r in range(4):
+        x = ks_round(x, (key >> (96 - 32*r)) & 0xffffffff)
+    return x
+
+parser = argparse.ArgumentParser(description="Encrypt a payload for the SMZ boot loader.")
+parser.add_argument("--key", default="0f1e2d3c4b5a69788796a5b4c3d2e1f0", help="128-bit key (hex), must match SMZ_BOOT_KEY")
+parser.add_argument("--nonce", default="5a17c0de", help="32-bit nonce (hex)")
+parser.add_argument("--load-addr", default="0", help="SRAM load address")
+parser.add_argument("--offset", default="0x100000", help="flash offset, must match SMZ_BOOT_IMAGE_ADDR")
+parser.add_argument("payload")
+parser.add_argument("image")
+args = parser.parse_args()
+
+key = int(args.key, 16)
+nonce = int(args.nonce, 16)
+load_addr = int(args.load_addr, 0)
+offset = int(args.offset, 0)
+
+with open(args.payload, "rb") as f:
+    data = f.read()
+
+data += b"\0" * (-len(data) % 4)
+nwords = len(data) // 4
+
+words = [MAGIC, nwords, load_addr, nonce]
+for i in range(nwords):
+    w, = struct.unpack_from("<I", data, 4*i)
+    words.append(w ^ keystream(key, nonce, i))
+
+image = b"".join(struct.pack("<I", w) for w in words)
+
+if args.image.endswith(".bin"):
+    with open(args.image, "wb") as f:
+        f.write(image)
+else:
+    with open(args.image, "w") as f:
+        print("@%08X" % offset, file=f)
+        for i in range(0, len(image), 16):
+            print(" ".join("%02X" % b for b in image[i:i+16]), file=f)
@@ -0,0 +1,434 @@
+/*
+ *  PicoSoC - A simple example SoC using PicoRV32
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+//
+// SMZ demand pager
+//
+// Backs a virtual secure window of VPAGES pages with FRAMES page frames of
+// on-chip RAM. The window contents are SMZ ciphertext (the keystream is bound
+// to the virtual address, see smz_layer.v), so pages are moved between the
+// frames and the swap area in SPI flash without any further encryption.
+//
+// Page-in reads the swap slot through the spimemio read port. Page-out of a
+// dirty victim bit-bangs WREN/SE/PP/RDSR through the spimemio config
+// register, so the flash must support 4 kB sector erase (20h) at every swap
+// slot. Like flashio in the firmware it first holds CS high, then clocks
+// FFFFh on all four IOs to take the flash out of continuous read mode. The
+// CPU is stalled (mem_ready low) for the whole fault.
+//
+// Victims are picked exact-LRU from per-frame age counters.
+//
+// Register file (reg_addr is the word index):
+//
+//   0  CTRL         W: bit 0 clears the counters, bit 1 drops all pages
+//                   R: {FRAMES[7:0], VPAGES[7:0], page size in bytes[15:0]}
+//   1  HITS         accesses that found their page resident (the access
+//                   that is replayed after a page-in is not counted)
+//   2  FAULTS       accesses that had to page in
+//   3  WRITEBACKS   dirty victims written back to flash
+//   4  PAGEIN_CYC   sum of page-in (flash read) cycles
+//   5  FAULT_CYC    sum of fault service cycles (incl. write-back)
+//   6  FAULT_MAX    longest single fault in cycles
+//   7  PAGEIN_MAX   longest single page-in in cycles
+//
+
+module smz_pager #(
+	parameter integer PAGE_WORDS = 64,
+	parameter integer FRAMES = 4,
+	parameter integer VPAGES = 64,
+	parameter [23:0] SWAP_BASE = 24'h 80_0000
+) (
+	input clk,
+	input resetn,
+
+	// CPU side (ciphertext, byte offset into the window)
+	input             valid,
+	output reg        ready,
+	input      [ 3:0] wstrb,
+	input      [23:0] addr,
+	input      [31:0] wdata,
+	output     [31:0] rdata,
+
+	// Statistics and control registers
+	input      [ 2:0] reg_addr,
+	input      [ 3:0] reg_we,
+	input      [31:0] reg_di,
+	output reg [31:0] reg_do,
+
+	// Page-in through the spimemio read port
+	output            flash_valid,
+	input             flash_ready,
+	output     [23:0] flash_addr,
+	input      [31:0] flash_rdata,
+
+	// Page-out through the spimemio config register
+	output            flash_cfg_busy,
+	output     [ 3:0] flash_cfg_we,
+	output     [31:0] flash_cfg_di,
+	input      [31:0] flash_cfg_do
+);
+	localparam integer WORD_BITS = $clog2(PAGE_WORDS);
+	localparam integer FRAME_BITS = FRAMES > 1 ? $clog2(FRAMES) : 1;
+	localparam integer VPAGE_BITS = VPAGES > 1 ? $clog2(VPAGES) : 1;
+	localparam integer SLOT_BITS = 12;
+	localparam [31:0] CONFIG_WORD = (FRAMES << 24) | (VPAGES << 16) | (4*PAGE_WORDS);
+
+	localparam [1:0] S_IDLE = 0;
+	localparam [1:0] S_FILL = 1;
+	localparam [1:0] S_SPI  = 2;
+	localparam [1:0] S_XIP  = 3;
+
+	// SPI write-back program steps
+	localparam [2:0] WB_CSB     = 0;
+	localparam [2:0] WB_CRM     = 1;
+	localparam [2:0] WB_WREN_SE = 2;
+	localparam [2:0] WB_SE      = 3;
+	localparam [2:0] WB_POLL_SE = 4;
+	localparam [2:0] WB_WREN_PP = 5;
+	localparam [2:0] WB_PP      = 6;
+	localparam [2:0] WB_POLL_PP = 7;
+
+	integer i;
+
+	reg [1:0] state;
+
+	// page table and frame table
+	reg [VPAGES-1:0] pt_valid;
+	reg [FRAME_BITS-1:0] pt_frame [0:VPAGES-1];
+
+	reg [FRAMES-1:0] ft_used;
+	reg [FRAMES-1:0] ft_dirty;
+	reg [VPAGE_BITS-1:0] ft_vpage [0:FRAMES-1];
+	reg [FRAME_BITS-1:0] ft_age [0:FRAMES-1];
+
+	wire [VPAGE_BITS-1:0] vpage = addr[WORD_BITS+2 +: VPAGE_BITS];
+	wire [WORD_BITS-1:0] vword = addr[2 +: WORD_BITS];
+	wire hit = pt_valid[vpage];
+	wire [FRAME_BITS-1:0] hit_frame = pt_frame[vpage];
+	wire access = state == S_IDLE && valid && !ready;
+
+	reg [FRAME_BITS-1:0] victim;
+	reg victim_found;
+
+	always @* begin
+		victim = 0;
+		victim_found = 0;
+		for (i = 0; i < FRAMES; i = i+1)
+			if (!victim_found && !ft_used[i]) begin
+				victim = i;
+				victim_found = 1;
+			end
+		for (i = 0; i < FRAMES; i = i+1)
+			if (!victim_found && ft_age[i] == FRAMES-1) begin
+				victim = i;
+				victim_found = 1;
+			end
+	end
+
+	// fault state
+	reg [FRAME_BITS-1:0] fault_frame;
+	reg [VPAGE_BITS-1:0] fault_vpage;
+	reg [VPAGE_BITS-1:0] wb_vpage;
+	reg [WORD_BITS:0] fill_word;
+	reg [31:0] fault_cycles;
+	reg [31:0] pagein_cycles;
+	reg replay;
+
+	// statistics
+	reg [31:0] cnt_hits;
+	reg [31:0] cnt_faults;
+	reg [31:0] cnt_writebacks;
+	reg [31:0] cnt_pagein_cyc;
+	reg [31:0] cnt_fault_cyc;
+	reg [31:0] cnt_fault_max;
+	reg [31:0] cnt_pagein_max;
+
+	// bit-bang SPI engine
+	reg [2:0] wb_step;
+	reg [WORD_BITS+2:0] spi_idx;
+	reg [WORD_BITS+2:0] spi_len;
+	reg [1:0] spi_phase;
+	reg [2:0] spi_bit;
+	reg [7:0] spi_in;
+	reg spi_gap;
+	reg bb_csb;
+	reg bb_clk;
+	reg bb_do;
+
+	wire [23:0] slot_addr = SWAP_BASE + ({fault_vpage, {SLOT_BITS{1'b0}}});
+	wire [23:0] wb_addr = SWAP_BASE + ({wb_vpage, {SLOT_BITS{1'b0}}});
+	wire [WORD_BITS+2:0] data_idx = spi_idx - 4;
+
+	assign flash_valid = state == S_FILL;
+	assign flash_addr = slot_addr + {fill_word[WORD_BITS-1:0], 2'b00};
+
+	// frame RAM
+	reg [31:0] frames [0:FRAMES*PAGE_WORDS-1];
+	reg [31:0] ram_rdata;
+	reg [FRAME_BITS+WORD_BITS-1:0] ram_addr;
+	reg [31:0] ram_wdata;
+	reg [3:0] ram_wen;
+
+	always @* begin
+		ram_addr = {hit_frame, vword};
+		ram_wdata = wdata;
+		ram_wen = access && hit ? wstrb : 4'b 0000;
+		if (state == S_FILL) begin
+			ram_addr = {fault_frame, fill_word[WORD_BITS-1:0]};
+			ram_wdata = flash_rdata;
+			ram_wen = flash_ready ? 4'b 1111 : 4'b 0000;
+		end
+		if (state == S_SPI)
+			ram_addr = {fault_frame, data_idx[WORD_BITS+1:2]};
+	end
+
+	always @(posedge clk) begin
+		ram_rdata <= frames[ram_addr];
+		if (ram_wen[0]) frames[ram_addr][ 7: 0] <= ram_wdata[ 7: 0];
+		if (ram_wen[1]) frames[ram_addr][15: 8] <= ram_wdata[15: 8];
+		if (ram_wen[2]) frames[ram_addr][23:16] <= ram_wdata[23:16];
+		if (ram_wen[3]) frames[ram_addr][31:24] <= ram_wdata[31:24];
+	end
+
+	assign rdata = ram_rdata;
+
+	// next byte to shift out for the current write-back step
+	reg [7:0] spi_tx;
+
+	always @* begin
+		spi_tx = 8'h 00;
+		case (wb_step)
+			WB_CRM: spi_tx = 8'h ff;
+			WB_WREN_SE, WB_WREN_PP: spi_tx = 8'h 06;
+			WB_POLL_SE, WB_POLL_PP: spi_tx = spi_idx == 0 ? 8'h 05 : 8'h 00;
+			WB_SE, WB_PP: begin
+				case (spi_idx)
+					0: spi_tx = wb_step == WB_SE ? 8'h 20 : 8'h 02;
+					1: spi_tx = wb_addr[23:16];
+					2: spi_tx = wb_addr[15:8];
+					3: spi_tx = wb_addr[7:0];
+					default: spi_tx = ram_rdata >> (8*data_idx[1:0]);
+				endcase
+			end
+		endcase
+	end
+
+	assign flash_cfg_busy = state == S_SPI || state == S_XIP;
+	assign flash_cfg_we = state == S_XIP ? 4'b 1001 : state == S_SPI ? 4'b 1011 : 4'b 0000;
+	wire bb_crm = wb_step == WB_CRM;
+
+	assign flash_cfg_di = state == S_XIP ? {1'b 1, 25'b 0, 1'b 1, 5'b 0} :
+			{1'b 0, 19'b 0, bb_crm ? 4'b 1111 : 4'b 0001, 2'b 00, bb_csb, bb_clk, {3{bb_crm}}, bb_do};
+
+	task touch_frame;
+		input [FRAME_BITS-1:0] frame;
+		begin
+			for (i = 0; i < FRAMES; i = i+1)
+				if (ft_age[i] < ft_age[frame])
+					ft_age[i] <= ft_age[i] + 1;
+			ft_age[frame] <= 0;
+		end
+	endtask
+
+	task start_step;
+		input [2:0] step;
+		begin
+			wb_step <= step;
+			spi_idx <= 0;
+			spi_phase <= 3;
+			spi_bit <= 7;
+			spi_gap <= 0;
+			bb_csb <= 0;
+			bb_clk <= 0;
+			case (step)
+				WB_WREN_SE, WB_WREN_PP: spi_len <= 1;
+				WB_CRM: spi_len <= 2;
+				WB_POLL_SE, WB_POLL_PP: spi_len <= 2;
+				WB_SE: spi_len <= 4;
+				default: spi_len <= 4 + 4*PAGE_WORDS;
+			endcase
+		end
+	endtask
+
+	always @(posedge clk) begin
+		ready <= 0;
+
+		if (state != S_IDLE)
+			fault_cycles <= fault_cycles + 1;
+
+		case (state)
+			S_IDLE: begin
+				if (access) begin
+					if (hit) begin
+						ready <= 1;
+						replay <= 0;
+						if (!replay)
+							cnt_hits <= cnt_hits + 1;
+						touch_frame(hit_frame);
+						if (|wstrb)
+							ft_dirty[hit_frame] <= 1;
+					end else begin
+						fault_frame <= victim;
+						fault_vpage <= vpage;
+						wb_vpage <= ft_vpage[victim];
+						fault_cycles <= 1;
+						pagein_cycles <= 0;
+						fill_word <= 0;
+						cnt_faults <= cnt_faults + 1;
+						if (ft_used[victim])
+							pt_valid[ft_vpage[victim]] <= 0;
+						if (ft_used[victim] && ft_dirty[victim]) begin
+							// en=0 with CS still high for the WB_CSB gap,
+							// ending any read spimemio left open
+							cnt_writebacks <= cnt_writebacks + 1;
+							state <= S_SPI;
+							wb_step <= WB_CSB;
+							spi_gap <= 1;
+							spi_phase <= 0;
+							bb_csb <= 1;
+							bb_clk <= 0;
+							bb_do <= 0;
+						end else begin
+							state <= S_FILL;
+						end
+					end
+				end
+			end
+			S_FILL: begin
+				pagein_cycles <= pagein_cycles + 1;
+				if (flash_ready) begin
+					fill_word <= fill_word + 1;
+					if (fill_word == PAGE_WORDS-1) begin
+						pt_valid[fault_vpage] <= 1;
+						pt_frame[fault_vpage] <= fault_frame;
+						ft_used[fault_frame] <= 1;
+						ft_dirty[fault_frame] <= 0;
+						ft_vpage[fault_frame] <= fault_vpage;
+						touch_frame(fault_frame);
+						cnt_pagein_cyc <= cnt_pagein_cyc + pagein_cycles + 1;
+						cnt_fault_cyc <= cnt_fault_cyc + fault_cycles;
+						if (pagein_cycles + 1 > cnt_pagein_max)
+							cnt_pagein_max <= pagein_cycles + 1;
+						if (fault_cycles > cnt_fault_max)
+							cnt_fault_max <= fault_cycles;
+						replay <= 1;
+						state <= S_IDLE;
+					end
+				end
+			end
+			S_SPI: begin
+				if (spi_gap) begin
+					// keep CS high for a few cycles between commands
+					spi_phase <= spi_phase + 1;
+					if (&spi_phase) begin
+						if ((wb_step == WB_POLL_SE || wb_step == WB_POLL_PP) && spi_in[0])
+							start_step(wb_step);
+						else if (wb_step == WB_POLL_PP)
+							state <= S_XIP;
+						else
+							start_step(wb_step + 1);
+					end
+				end else begin
+					case (spi_phase)
+						0: begin
+							bb_clk <= 0;
+							bb_do <= spi_tx[spi_bit];
+							spi_phase <= 1;
+						end
+						1: begin
+							bb_clk <= 1;
+							spi_phase <= 2;
+						end
+						2: begin
+							spi_in <= {spi_in, flash_cfg_do[1]};
+							spi_phase <= 0;
+							spi_bit <= spi_bit - 1;
+							if (spi_bit == 0) begin
+								spi_idx <= spi_idx + 1;
+								spi_phase <= 3;
+								if (spi_idx == spi_len - 1) begin
+									bb_clk <= 0;
+									bb_csb <= 1;
+									spi_gap <= 1;
+									spi_phase <= 0;
+								end
+							end
+						end
+						3: begin
+							// byte boundary: give the frame RAM a cycle to fetch the next data word
+							spi_phase <= 0;
+						end
+					endcase
+				end
+			end
+			S_XIP: begin
+				bb_csb <= 1;
+				state <= S_FILL;
+			end
+		endcase
+
+		if (reg_we[0] && reg_addr == 0) begin
+			if (reg_di[0]) begin
+				cnt_hits <= 0;
+				cnt_faults <= 0;
+				cnt_writebacks <= 0;
+				cnt_pagein_cyc <= 0;
+				cnt_fault_cyc <= 0;
+				cnt_fault_max <= 0;
+				cnt_pagein_max <= 0;
+			end
+			if (reg_di[1] && state == S_IDLE) begin
+				pt_valid <= 0;
+				ft_used <= 0;
+				ft_dirty <= 0;
+			end
+		end
+
+		if (!resetn) begin
+			state <= S_IDLE;
+			replay <= 0;
+			pt_valid <= 0;
+			ft_used <= 0;
+			ft_dirty <= 0;
+			for (i = 0; i < FRAMES; i = i+1)
+				ft_age[i] <= i;
+			bb_csb <= 1;
+			bb_clk <= 0;
+			bb_do <= 0;
+			cnt_hits <= 0;
+			cnt_faults <= 0;
+			cnt_writebacks <= 0;
+			cnt_pagein_cyc <= 0;
+			cnt_fault_cyc <= 0;
+			cnt_fault_max <= 0;
+			cnt_pagein_max <= 0;
+		end
+	end
+
+	always @* begin
+		case (reg_addr)
+			0: reg_do = CONFIG_WORD;
+			1: reg_do = cnt_hits;
+			2: reg_do = cnt_faults;
+			3: reg_do = cnt_writebacks;
+			4: reg_do = cnt_pagein_cyc;
+			5: reg_do = cnt_fault_cyc;
+			6: reg_do = cnt_fault_max;
+			7: reg_do = cnt_pagein_max;
+		endcase
+	end
+endmodule
@@ -0,0 +1,259 @@
+/*
+ *  PicoSoC - A simple example SoC using PicoRV32
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+`timescale 1 ns / 1 ps
+
+//
+// smz_pager write-back test: smz_pager, spimemio and the spiflash model
+// wired up as in picosoc.v. For each spimemio read mode (with continuous
+// read where the mode has it) it writes more pages than there are frames,
+// so that dirty victims are written back to flash, then reads every page
+// back and checks the data and the HITS/FAULTS/WRITEBACKS counters.
+//
+
+module testbench;
+	localparam integer PAGE_WORDS = 16;
+	localparam integer FRAMES = 2;
+	localparam integer VPAGES = 8;
+	localparam integer PAGES = FRAMES + 3;
+
+	reg clk = 1;
+	reg resetn = 0;
+
+	always #5 clk = ~clk;
+
+	initial begin
+		if ($test$plusargs("vcd")) begin
+			$dumpfile("smz_pager_tb.vcd");
+			$dumpvars(0, testbench);
+		end
+		repeat (10) @(posedge clk);
+		resetn <= 1;
+	end
+
+	initial begin
+		repeat (2000000) @(posedge clk);
+		$display("TIMEOUT");
+		$finish;
+	end
+
+	// CPU side of the pager and the spimemio config register
+	reg         valid = 0;
+	wire        ready;
+	reg  [ 3:0] wstrb = 0;
+	reg  [23:0] addr = 0;
+	reg  [31:0] wdata = 0;
+	wire [31:0] rdata;
+
+	reg  [ 2:0] reg_addr = 0;
+	reg  [ 3:0] reg_we = 0;
+	reg  [31:0] reg_di = 0;
+	wire [31:0] reg_do;
+
+	reg  [ 3:0] cfgreg_we = 0;
+	reg  [31:0] cfgreg_di = 0;
+
+	wire        pager_flash_valid;
+	wire [23:0] pager_flash_addr;
+	wire        spimem_ready;
+	wire [31:0] spimem_rdata;
+	wire        pager_cfg_busy;
+	wire [ 3:0] pager_cfg_we;
+	wire [31:0] pager_cfg_di;
+	wire [31:0] spimemio_cfgreg_do;
+
+	wire flash_csb, flash_clk;
+	wire flash_io0_oe, flash_io1_oe, flash_io2_oe, flash_io3_oe;
+	wire flash_io0_do, flash_io1_do, flash_io2_do, flash_io3_do;
+	wire flash_io0, flash_io1, flash_io2, flash_io3;
+
+	assign flash_io0 = flash_io0_oe ? flash_io0_do : 1'bz;
+	assign flash_io1 = flash_io1_oe ? flash_io1_do : 1'bz;
+	assign flash_io2 = flash_io2_oe ? flash_io2_do : 1'bz;
+	assign flash_io3 = flash_io3_oe ? flash_io3_do : 1'bz;
+
+	smz_pager #(
+		.PAGE_WORDS(PAGE_WORDS),
+		.FRAMES    (FRAMES    ),
+		.VPAGES    (VPAGES    )
+	) pager (
+		.clk           (clk               ),
+		.resetn        (resetn            ),
+		.valid         (valid             ),
+		.ready         (ready             ),
+		.wstrb         (wstrb             ),
+		.addr          (addr              ),
+		.wdata         (wdata             ),
+		.rdata         (rdata             ),
+		.reg_addr      (reg_addr          ),
+		.reg_we        (reg_we            ),
+		.reg_di        (reg_di            ),
+		.reg_do        (reg_do            ),
+		.flash_valid   (pager_flash_valid ),
+		.flash_ready   (spimem_ready      ),
+		.flash_addr    (pager_flash_addr  ),
+		.flash_rdata   (spimem_rdata      ),
+		.flash_cfg_busy(pager_cfg_busy    ),
+		.flash_cfg_we  (pager_cfg_we      ),
+		.flash_cfg_di  (pager_cfg_di      ),
+		.flash_cfg_do  (spimemio_cfgreg_do)
+	);
+
+	spimemio spimemio (
+		.clk         (clk              ),
+		.resetn      (resetn           ),
+		.valid       (pager_flash_valid),
+		.ready       (spimem_ready     ),
+		.addr        (pager_flash_addr ),
+		.rdata       (spimem_rdata     ),
+		.flash_csb   (flash_csb        ),
+		.flash_clk   (flash_clk        ),
+		.flash_io0_oe(flash_io0_oe     ),
+		.flash_io1_oe(flash_io1_oe     ),
+		.flash_io2_oe(flash_io2_oe     ),
+		.flash_io3_oe(flash_io3_oe     ),
+		.flash_io0_do(flash_io0_do     ),
+		.flash_io1_do(flash_io1_do     ),
+		.flash_io2_do(flash_io2_do     ),
+		.flash_io3_do(flash_io3_do     ),
+		.flash_io0_di(flash_io0        ),
+		.flash_io1_di(flash_io1        ),
+		.flash_io2_di(flash_io2        ),
+		.flash_io3_di(flash_io3        ),
+		.cfgreg_we   (pager_cfg_busy ? pager_cfg_we : cfgreg_we),
+		.cfgreg_di   (pager_cfg_busy ? pager_cfg_di : cfgreg_di),
+		.cfgreg_do   (spimemio_cfgreg_do)
+	);
+
+	spiflash spiflash (
+		.csb(flash_csb),
+		.clk(flash_clk),
+		.io0(flash_io0),
+		.io1(flash_io1),
+		.io2(flash_io2),
+		.io3(flash_io3)
+	);
+
+	integer errcount = 0;
+	integer accesses;
+
+	task access;
+		input [23:0] a;
+		input [3:0] strb;
+		input [31:0] data;
+		begin
+			valid <= 1;
+			addr <= a;
+			wstrb <= strb;
+			wdata <= data;
+			@(posedge clk);
+			while (!ready)
+				@(posedge clk);
+			valid <= 0;
+			accesses = accesses + 1;
+		end
+	endtask
+
+	task read_counter;
+		input [2:0] index;
+		output [31:0] value;
+		begin
+			reg_addr <= index;
+			@(posedge clk);
+			value = reg_do;
+		end
+	endtask
+
+	function [31:0] pattern;
+		input integer mode;
+		input integer page;
+		input integer word;
+		begin
+			pattern = 32'h 9e37_79b9 * (mode * 256 + page * PAGE_WORDS + word + 1);
+		end
+	endfunction
+
+	// spimemio read modes, see set_flash_mode_*() and enable_flash_crm() in firmware.c
+	localparam integer MODES = 4;
+	reg [31:0] mode_cfg [0:MODES-1];
+	initial begin
+		mode_cfg[0] = 32'h 0000_0000; // SPI
+		mode_cfg[1] = 32'h 0050_0000; // dual I/O, continuous read
+		mode_cfg[2] = 32'h 0034_0000; // quad I/O, continuous read
+		mode_cfg[3] = 32'h 0077_0000; // quad I/O DDR, continuous read
+	end
+
+	integer mode, page, word;
+	reg [31:0] hits, faults, writebacks;
+
+	initial begin
+		@(posedge resetn);
+		repeat (10) @(posedge clk);
+
+		for (mode = 0; mode < MODES; mode = mode + 1) begin
+			cfgreg_we <= 4'b 0100;
+			cfgreg_di <= mode_cfg[mode];
+			@(posedge clk);
+			cfgreg_we <= 0;
+
+			// drop all pages and clear the counters
+			reg_addr <= 0;
+			reg_we <= 4'b 0001;
+			reg_di <= 3;
+			@(posedge clk);
+			reg_we <= 0;
+			accesses = 0;
+
+			for (page = 0; page < PAGES; page = page + 1)
+				for (word = 0; word < PAGE_WORDS; word = word + 1)
+					access(4 * (page * PAGE_WORDS + word), 4'b 1111, pattern(mode, page, word));
+
+			for (page = 0; page < PAGES; page = page + 1)
+				for (word = 0; word < PAGE_WORDS; word = word + 1) begin
+					access(4 * (page * PAGE_WORDS + word), 4'b 0000, 0);
+					if (rdata !== pattern(mode, page, word)) begin
+						$display("ERROR: mode %0d page %0d word %0d: got %08x, expected %08x",
+								mode, page, word, rdata, pattern(mode, page, word));
+						errcount = errcount + 1;
+					end
+				end
+
+			read_counter(1, hits);
+			read_counter(2, faults);
+			read_counter(3, writebacks);
+			$display("mode %0d (cfg %08x): %0d accesses, %0d hits, %0d faults, %0d writebacks",
+					mode, mode_cfg[mode], accesses, hits, faults, writebacks);
+
+			// every page is evicted dirty once before it is read back
+			if (writebacks < PAGES) begin
+				$display("ERROR: mode %0d: %0d writebacks, expected at least %0d", mode, writebacks, PAGES);
+				errcount = errcount + 1;
+			end
+			if (hits + faults != accesses) begin
+				$display("ERROR: mode %0d: hits + faults = %0d, expected %0d accesses", mode, hits + faults, accesses);
+				errcount = errcount + 1;
+			end
+		end
+
+		if (errcount) begin
+			$display("FAILED: %0d errors", errcount);
+			$stop;
+		end
+		$display("PASSED");
+		$finish;
+	end
+endmodule
@@ -0,0 +1,271 @@
+/*
+ *  PicoSoC - A simple example SoC using PicoRV32
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+//
+// SMZ measurement engine (SHA-256)
+//
+// A bus master that reads LEN bytes from ADDR and returns their SHA-256
+// digest. The reads go over the SoC bus like CPU loads, so a range inside
+// the SMZ window is hashed as plaintext after the smz_layer decrypt, and
+// firmware can attest the secure region without touching every word.
+//
+// The bytes are hashed in address order, so the digest is the plain
+// SHA-256 of the memory contents (e.g. sha256sum of the image that was
+// loaded there). Padding and the length block are generated by the engine.
+//
+// The compression function does four rounds per cycle, so a 16 word block
+// takes 16 cycles while the next block is fetched into a second buffer. The
+// engine keeps up with a bus that delivers one word per cycle; on picosoc it
+// is limited by the bus handshake and the arbitration with the CPU.
+//
+// Registers (reg_addr is the word index):
+//
+//   0  CTRL     W: bit 0 start, bit 1 clear DONE, bit 2 IRQ enable
+//               R: bit 0 BUSY, bit 1 DONE, bit 2 IRQ enable
+//   1  ADDR     start address (word aligned)
+//   2  LEN      length in bytes (multiple of 4)
+//   3  CYCLES   cycles taken by the last run
+//   8..15       DIGEST H0..H7, valid while DONE is set
+//
+// irq is raised while DONE and IRQ enable are both set.
+//
+
+module smz_sha256 (
+	input clk,
+	input resetn,
+
+	output irq,
+
+	// bus master (read only)
+	output            mem_valid,
+	input             mem_ready,
+	output     [31:0] mem_addr,
+	input      [31:0] mem_rdata,
+
+	input      [ 3:0] reg_addr,
+	input      [ 3:0] reg_we,
+	input      [31:0] reg_di,
+	output reg [31:0] reg_do
+);
+	integer i;
+
+	reg busy, done, irq_en;
+	reg [31:0] addr, len, cycles;
+	reg [31:0] hash [0:7];
+
+	// padded message stream
+	reg [26:0] msg_idx;
+	wire [26:0] msg_words = len[28:2];
+	wire [26:0] pad_words = {(msg_words + 27'd 2) >> 4, 4'b 0000} + 27'd 16;
+	wire msg_end = msg_idx == pad_words;
+
+	// block buffer, filled while the previous block is compressed
+	reg [31:0] blk [0:15];
+	reg [4:0] blk_cnt;
+	wire blk_full = blk_cnt[4];
+
+	reg [31:0] pad_word;
+
+	always @* begin
+		pad_word = 0;
+		if (msg_idx == msg_words)
+			pad_word = 32'h 8000_0000;
+		if (msg_idx == pad_words - 2)
+			pad_word = len >> 29;
+		if (msg_idx == pad_words - 1)
+			pad_word = len << 3;
+	end
+
+	assign mem_valid = busy && !blk_full && !msg_end && msg_idx < msg_words;
+	assign mem_addr = addr + {msg_idx, 2'b 00};
+
+	wire blk_push = busy && !blk_full && !msg_end && (msg_idx < msg_words ? mem_ready : 1'b 1);
+	wire [31:0] blk_word = msg_idx < msg_words ? {mem_rdata[7:0], mem_rdata[15:8], mem_rdata[23:16], mem_rdata[31:24]} : pad_word;
+
+	// compression, four rounds per cycle over a sliding message window
+
+	function [31:0] ror;
+		input [31:0] x;
+		input [4:0] n;
+		ror = (x >> n) | (x << (6'd 32 - n));
+	endfunction
+
+	function [31:0] sig0;
+		input [31:0] x;
+		sig0 = ror(x, 7) ^ ror(x, 18) ^ (x >> 3);
+	endfunction
+
+	function [31:0] sig1;
+		input [31:0] x;
+		sig1 = ror(x, 17) ^ ror(x, 19) ^ (x >> 10);
+	endfunction
+
+	function [31:0] sha256_k;
+		input [5:0] t;
+		case (t)
+			 0: sha256_k = 32'h 428a2f98;  1: sha256_k = 32'h 71374491;  2: sha256_k = 32'h b5c0fbcf;  3: sha256_k = 32'h e9b5dba5;
+			 4: sha256_k = 32'h 3956c25b;  5: sha256_k = 32'h 59f111f1;  6: sha256_k = 32'h 923f82a4;  7: sha256_k = 32'h ab1c5ed5;
+			 8: sha256_k = 32'h d807aa98;  9: sha256_k = 32'h 12835b01; 10: sha256_k = 32'h 243185be; 11: sha256_k = 32'h 550c7dc3;
+			12: sha256_k = 32'h 72be5d74; 13: sha256_k = 32'h 80deb1fe; 14: sha256_k = 32'h 9bdc06a7; 15: sha256_k = 32'h c19bf174;
+			16: sha256_k = 32'h e49b69c1; 17: sha256_k = 32'h efbe4786; 18: sha256_k = 32'h 0fc19dc6; 19: sha256_k = 32'h 240ca1cc;
+			20: sha256_k = 32'h 2de92c6f; 21: sha256_k = 32'h 4a7484aa; 22: sha256_k = 32'h 5cb0a9dc; 23: sha256_k = 32'h 76f988da;
+			24: sha256_k = 32'h 983e5152; 25: sha256_k = 32'h a831c66d; 26: sha256_k = 32'h b00327c8; 27: sha256_k = 32'h bf597fc7;
+			28: sha256_k = 32'h c6e00bf3; 29: sha256_k = 32'h d5a79147; 30: sha256_k = 32'h 06ca6351; 31: sha256_k = 32'h 14292967;
+			32: sha256_k = 32'h 27b70a85; 33: sha256_k = 32'h 2e1b2138; 34: sha256_k = 32'h 4d2c6dfc; 35: sha256_k = 32'h 53380d13;
+			36: sha256_k = 32'h 650a7354; 37: sha256_k = 32'h 766a0abb; 38: sha256_k = 32'h 81c2c92e; 39: sha256_k = 32'h 92722c85;
+			40: sha256_k = 32'h a2bfe8a1; 41: sha256_k = 32'h a81a664b; 42: sha256_k = 32'h c24b8b70; 43: sha256_k = 32'h c76c51a3;
+			44: sha256_k = 32'h d192e819; 45: sha256_k = 32'h d6990624; 46: sha256_k = 32'h f40e3585; 47: sha256_k = 32'h 106aa070;
+			48: sha256_k = 32'h 19a4c116; 49: sha256_k = 32'h 1e376c08; 50: sha256_k = 32'h 2748774c; 51: sha256_k = 32'h 34b0bcb5;
+			52: sha256_k = 32'h 391c0cb3; 53: sha256_k = 32'h 4ed8aa4a; 54: sha256_k = 32'h 5b9cca4f; 55: sha256_k = 32'h 682e6ff3;
+			56: sha256_k = 32'h 748f82ee; 57: sha256_k = 32'h 78a5636f; 58: sha256_k = 32'h 84c87814; 59: sha256_k = 32'h 8cc70208;
+			60: sha256_k = 32'h 90befffa; 61: sha256_k = 32'h a4506ceb; 62: sha256_k = 32'h bef9a3f7; 63: sha256_k = 32'h c67178f2;
+		endcase
+	endfunction
+
+	// four rounds on the packed state {a, b, c, d, e, f, g, h}
+	function [255:0] sha256_rounds;
+		input [255:0] st;
+		input [127:0] w4;
+		input [3:0] step;
+		reg [31:0] a, b, c, d, e, f, g, h, t1, t2;
+		integer r;
+		begin
+			{a, b, c, d, e, f, g, h} = st;
+			for (r = 0; r < 4; r = r+1) begin
+				t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) +
+						sha256_k({step, 2'b 00} + r) + w4[32*r +: 32];
+				t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			end
+			sha256_rounds = {a, b, c, d, e, f, g, h};
+		end
+	endfunction
+
+	reg comp_busy, comp_last;
+	reg [3:0] comp_step;
+	reg [31:0] w [0:15];
+	reg [255:0] st;
+
+	wire [255:0] nst = sha256_rounds(st, {w[3], w[2], w[1], w[0]}, comp_step);
+	wire [31:0] nw0 = sig1(w[14]) + w[ 9] + sig0(w[1]) + w[0];
+	wire [31:0] nw1 = sig1(w[15]) + w[10] + sig0(w[2]) + w[1];
+	wire [31:0] nw2 = sig1(nw0) + w[11] + sig0(w[3]) + w[2];
+	wire [31:0] nw3 = sig1(nw1) + w[12] + sig0(w[4]) + w[3];
+
+	wire comp_start = busy && blk_full && !comp_busy;
+
+	always @(posedge clk) begin
+		if (busy)
+			cycles <= cycles + 1;
+
+		if (blk_push) begin
+			blk[blk_cnt[3:0]] <= blk_word;
+			blk_cnt <= blk_cnt + 1;
+			msg_idx <= msg_idx + 1;
+		end
+
+		if (comp_start) begin
+			for (i = 0; i < 16; i = i+1)
+				w[i] <= blk[i];
+			st <= {hash[0], hash[1], hash[2], hash[3], hash[4], hash[5], hash[6], hash[7]};
+			blk_cnt <= 0;
+			comp_busy <= 1;
+			comp_step <= 0;
+			comp_last <= msg_end;
+		end
+
+		if (comp_busy) begin
+			for (i = 0; i < 12; i = i+1)
+				w[i] <= w[i+4];
+			w[12] <= nw0;
+			w[13] <= nw1;
+			w[14] <= nw2;
+			w[15] <= nw3;
+			st <= nst;
+			comp_step <= comp_step + 1;
+			if (&comp_step) begin
+				for (i = 0; i < 8; i = i+1)
+					hash[i] <= hash[i] + nst[32*(7-i) +: 32];
+				comp_busy <= 0;
+				if (comp_last) begin
+					busy <= 0;
+					done <= 1;
+				end
+			end
+		end
+
+		if (reg_addr == 0 && reg_we[0]) begin
+			irq_en <= reg_di[2];
+			if (reg_di[1])
+				done <= 0;
+			if (reg_di[0] && !busy) begin
+				busy <= 1;
+				done <= 0;
+				cycles <= 0;
+				msg_idx <= 0;
+				blk_cnt <= 0;
+				comp_busy <= 0;
+				hash[0] <= 32'h 6a09e667;
+				hash[1] <= 32'h bb67ae85;
+				hash[2] <= 32'h 3c6ef372;
+				hash[3] <= 32'h a54ff53a;
+				hash[4] <= 32'h 510e527f;
+				hash[5] <= 32'h 9b05688c;
+				hash[6] <= 32'h 1f83d9ab;
+				hash[7] <= 32'h 5be0cd19;
+			end
+		end
+		if (!busy) begin
+			if (reg_addr == 1 && reg_we == 4'b 1111)
+				addr <= {reg_di[31:2], 2'b 00};
+			if (reg_addr == 2 && reg_we == 4'b 1111)
+				len <= {3'b 000, reg_di[28:2], 2'b 00};
+		end
+
+		if (!resetn) begin
+			busy <= 0;
+			done <= 0;
+			irq_en <= 0;
+			comp_busy <= 0;
+			blk_cnt <= 0;
+			msg_idx <= 0;
+			addr <= 0;
+			len <= 0;
+			cycles <= 0;
+		end
+	end
+
+	assign irq = done && irq_en;
+
+	always @* begin
+		case (reg_addr)
+			0: reg_do = {29'b 0, irq_en, done, busy};
+			1: reg_do = addr;
+			2: reg_do = len;
+			3: reg_do = cycles;
+			8, 9, 10, 11, 12, 13, 14, 15: reg_do = hash[reg_addr[2:0]];
+			default: reg_do = 0;
+		endcase
+	end
+endmodule
@@ -0,0 +1,133 @@
+/*
+ *  PicoSoC - A simple example SoC using PicoRV32
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// Payload for the SMZ boot loader. It runs from SRAM after smz_bootload.v
+// has decrypted it, checks the loaded text against the flash image and
+// compares the hardware boot time with a software decrypt and a plain
+// XIP copy of the same image.
+
+#include <stdint.h>
+
+#define reg_uart_clkdiv (*(volatile uint32_t*)0x02000004)
+#define reg_uart_data (*(volatile uint32_t*)0x02000008)
+#define reg_leds (*(volatile uint32_t*)0x03000000)
+
+#define reg_smz_boot_status (*(volatile uint32_t*)0x02000040)
+#define reg_smz_boot_cycles (*(volatile uint32_t*)0x02000044)
+#define reg_smz_boot_words (*(volatile uint32_t*)0x02000048)
+
+// must match SMZ_BOOT_IMAGE_ADDR and SMZ_BOOT_KEY in picosoc.v
+#define smz_boot_image ((volatile uint32_t*)0x01100000)
+static const uint32_t smz_boot_key[4] = { 0x0f1e2d3c, 0x4b5a6978, 0x8796a5b4, 0xc3d2e1f0 };
+
+extern uint32_t _etext;
+
+static inline uint32_t rdcycle(void)
+{
+	uint32_t cycles;
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles));
+	return cycles;
+}
+
+void putchar(char c)
+{
+	if (c == '\n')
+		putchar('\r');
+	reg_uart_data = c;
+}
+
+void print(const char *p)
+{
+	while (*p)
+		putchar(*(p++));
+}
+
+void print_hex(uint32_t v, int digits)
+{
+	for (int i = 7; i >= 0; i--) {
+		char c = "0123456789abcdef"[(v >> (4*i)) & 15];
+		if (c == '0' && i >= digits) continue;
+		putchar(c);
+		digits = i;
+	}
+}
+
+static uint32_t ks_round(uint32_t x, uint32_t k)
+{
+	uint32_t t = x + k;
+	return t ^ ((t << 7) | (t >> 25)) ^ ((t << 19) | (t >> 13));
+}
+
+static uint32_t smz_boot_keystream(uint32_t nonce, uint32_t i)
+{
+	uint32_t x = nonce ^ i;
+	for (int r = 0; r < 4; r++)
+		x = ks_round(x, smz_boot_key[r]);
+	return x;
+}
+
+static void print_result(const char *name, uint32_t cycles)
+{
+	print(name);
+	print("0x");
+	print_hex(cycles, 8);
+	print(" cycles\n");
+}
+
+void main()
+{
+	reg_leds = 31;
+	reg_uart_clkdiv = 104;
+
+	uint32_t status = reg_smz_boot_status;
+	uint32_t nwords = smz_boot_image[1];
+	uint32_t nonce = smz_boot_image[3];
+	volatile uint32_t *payload = smz_boot_image + 4;
+	uint32_t *sram = (uint32_t*)smz_boot_image[2];
+	uint32_t text_words = ((uint32_t)&_etext - (uint32_t)sram) >> 2;
+
+	print("\nSMZ secure boot\n");
+	print("  status:      0x");
+	print_hex(status, 1);
+	print("\n  words:       0x");
+	print_hex(reg_smz_boot_words, 1);
+	print("\n");
+	print_result("  hw decrypt:  ", reg_smz_boot_cycles);
+
+	uint32_t t0 = rdcycle();
+	uint32_t errors = 0;
+	for (uint32_t i = 0; i < nwords; i++) {
+		uint32_t w = payload[i] ^ smz_boot_keystream(nonce, i);
+		if (i < text_words && w != sram[i])
+			errors++;
+	}
+	uint32_t t1 = rdcycle();
+
+	volatile uint32_t sink = 0;
+	for (uint32_t i = 0; i < nwords; i++)
+		sink ^= payload[i];
+	uint32_t t2 = rdcycle();
+
+	print_result("  sw decrypt:  ", t1 - t0);
+	print_result("  xip copy:    ", t2 - t1);
+	print("  mismatches:  0x");
+	print_hex(errors, 1);
+	print("\n\n");
+
+	reg_leds = errors || status != 1 ? 0x40 : 0x80;
+	print(errors || status != 1 ? "FAIL\n" : "PASS\n");
+}
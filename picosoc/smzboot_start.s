@@ -0,0 +1,21 @@
+# Entry point of the SMZ boot payload. The boot loader has already written
+# .text and .data into SRAM, so only .bss needs clearing here.
+
+.section .text.start
+
+start:
+
+# zero-init bss section
+la a0, _sbss
+la a1, _ebss
+bge a0, a1, end_init_bss
+loop_init_bss:
+sw zero, 0(a0)
+addi a0, a0, 4
+blt a0, a1, loop_init_bss
+end_init_bss:
+
+# call main
+call main
+loop:
+j loop
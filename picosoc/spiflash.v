@@ -26,7 +26,9 @@
 // updates output signals 1ns after the SPI clock edge.
 //
 // Supported commands:
-//    AB, B9, FF, 03, BB, EB, ED
+//    AB, B9, FF, 03, BB, EB, ED, 06, 04, 05, 02, 20
+//
+// Program and erase complete instantly, so RDSR never reports WIP.
 //
 // Well written SPI flash data sheets:
 //    Cypress S25FL064L http://www.cypress.com/file/316661/download
@@ -61,6 +63,7 @@ module spiflash (
 	reg spi_io_vld;
 
 	reg powered_up = 0;
+	reg write_enabled = 0;
 
 	localparam [3:0] mode_spi         = 1;
 	localparam [3:0] mode_dspi_rd     = 2;
@@ -101,6 +104,8 @@ module spiflash (
 	// 16 MB (128Mb) Flash
 	reg [7:0] memory [0:16*1024*1024-1];
 
+	integer erase_idx;
+
 	reg [1023:0] firmware_file;
 	initial begin
 		if (!$value$plusargs("firmware=%s", firmware_file))
@@ -123,6 +128,47 @@ module spiflash (
 
 				if (spi_cmd == 8'h ff)
 					xip_cmd = 0;
+
+				if (spi_cmd == 8'h 06)
+					write_enabled = 1;
+
+				if (spi_cmd == 8'h 04)
+					write_enabled = 0;
+			end
+
+			if (powered_up && spi_cmd == 'h 05) begin
+				if (bytecount >= 1)
+					buffer = {6'b 0, write_enabled, 1'b 0};
+			end
+
+			if (powered_up && write_enabled && spi_cmd == 'h 02) begin
+				if (bytecount == 2)
+					spi_addr[23:16] = buffer;
+
+				if (bytecount == 3)
+					spi_addr[15:8] = buffer;
+
+				if (bytecount == 4)
+					spi_addr[7:0] = buffer;
+
+				if (bytecount >= 5) begin
+					memory[spi_addr] = memory[spi_addr] & buffer;
+					spi_addr[7:0] = spi_addr[7:0] + 1;
+				end
+			end
+
+			if (powered_up && write_enabled && spi_cmd == 'h 20) begin
+				if (bytecount == 2)
+					spi_addr[23:16] = buffer;
+
+				if (bytecount == 3)
+					spi_addr[15:8] = buffer;
+
+				if (bytecount == 4) begin
+					spi_addr[7:0] = buffer;
+					for (erase_idx = 0; erase_idx < 4096; erase_idx = erase_idx + 1)
+						memory[{spi_addr[23:12], 12'h 000} + erase_idx] = 8'h ff;
+				end
 			end
 
 			if (powered_up && spi_cmd == 'h 03) begin
@@ -268,6 +314,8 @@ module spiflash (
 				$display("");
 				$fflush;
 			end
+			if (spi_cmd == 8'h 02 || spi_cmd == 8'h 20)
+				write_enabled = 0;
 			buffer = 0;
 			bitcount = 0;
 			bytecount = 0;
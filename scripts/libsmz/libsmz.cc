@@ -0,0 +1,348 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "libsmz.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define SMZ_X86 1
+#  include <immintrin.h>
+#endif
+
+static const uint32_t smz_addr_const = 0xDEADBEEF;
+
+static inline uint32_t smz_rotl(uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t smz_boot_round(uint32_t x, uint32_t k)
+{
+	uint32_t t = x + k;
+	return t ^ smz_rotl(t, 7) ^ smz_rotl(t, 19);
+}
+
+static inline int smz_boot_rounds(const smz_cipher &c)
+{
+	return c.rounds ? c.rounds : 4;
+}
+
+// Trivium with the registers bit reversed (s(N) in bit 0), so that the
+// values of a tap over the next 32 steps are 32 adjacent bits
+struct smz_trivium_reg {
+	uint64_t lo, hi;
+};
+
+static inline uint32_t smz_trivium_tap(const smz_trivium_reg &r, int n, int k)
+{
+	int p = n - k;
+	if (p >= 64)
+		return r.hi >> (p - 64);
+	return (r.lo >> p) | (p ? r.hi << (64 - p) : 0);
+}
+
+static inline void smz_trivium_shift(smz_trivium_reg &r, int n, uint32_t t)
+{
+	int q = n - 32;
+	r.lo = (r.lo >> 32) | (r.hi << 32);
+	r.hi >>= 32;
+	if (q >= 64) {
+		r.hi |= (uint64_t)t << (q - 64);
+	} else {
+		r.lo |= (uint64_t)t << q;
+		r.hi |= (uint64_t)t >> (64 - q);
+	}
+}
+
+static inline void smz_trivium_set(smz_trivium_reg &r, int n, int k)
+{
+	if (n - k >= 64)
+		r.hi |= 1ULL << (n - k - 64);
+	else
+		r.lo |= 1ULL << (n - k);
+}
+
+// 32 steps, returns the output bits (first in bit 0)
+static inline uint32_t smz_trivium_round(smz_trivium_reg *s)
+{
+	smz_trivium_reg &a = s[0], &b = s[1], &c = s[2];
+	uint32_t t1 = smz_trivium_tap(a, 93, 66) ^ smz_trivium_tap(a, 93, 93);
+	uint32_t t2 = smz_trivium_tap(b, 84, 69) ^ smz_trivium_tap(b, 84, 84);
+	uint32_t t3 = smz_trivium_tap(c, 111, 66) ^ smz_trivium_tap(c, 111, 111);
+	uint32_t z = t1 ^ t2 ^ t3;
+	t1 ^= (smz_trivium_tap(a, 93, 91) & smz_trivium_tap(a, 93, 92)) ^ smz_trivium_tap(b, 84, 78);
+	t2 ^= (smz_trivium_tap(b, 84, 82) & smz_trivium_tap(b, 84, 83)) ^ smz_trivium_tap(c, 111, 87);
+	t3 ^= (smz_trivium_tap(c, 111, 109) & smz_trivium_tap(c, 111, 110)) ^ smz_trivium_tap(a, 93, 69);
+	smz_trivium_shift(a, 93, t3);
+	smz_trivium_shift(b, 84, t1);
+	smz_trivium_shift(c, 111, t2);
+	return z;
+}
+
+static void smz_trivium_line(const smz_cipher &c, uint32_t line, uint32_t *ks)
+{
+	// 80 bit key and iv, bit i is loaded into s(i+1) and s(i+94)
+	uint64_t key[2] = { (uint64_t)c.key[0] << 48 | (uint64_t)c.key[1] << 16 | c.key[2] >> 16, c.key[0] >> 16 };
+	uint64_t iv[2] = { (uint64_t)c.key[3] << 32 | line, c.key[2] & 0xffff };
+	smz_trivium_reg s[3] = { { 0, 0 }, { 0, 0 }, { 7, 0 } };
+	for (int i = 0; i < 80; i++) {
+		if ((key[i / 64] >> (i % 64)) & 1)
+			smz_trivium_set(s[0], 93, i + 1);
+		if ((iv[i / 64] >> (i % 64)) & 1)
+			smz_trivium_set(s[1], 84, i + 1);
+	}
+	for (int i = 0; i < 1152 / 32; i++)
+		smz_trivium_round(s);
+	for (int i = 0; i < SMZ_TRIVIUM_LINE_WORDS; i++)
+		ks[i] = smz_trivium_round(s);
+}
+
+uint32_t smz_keystream(const smz_cipher &c, uint32_t pos)
+{
+	switch (c.mode) {
+	case SMZ_MODE_ADDR:
+		return pos ^ smz_addr_const;
+	case SMZ_MODE_KEY:
+		return c.key[0] ^ c.key[1] ^ c.key[2] ^ c.key[3];
+	case SMZ_MODE_BOOT: {
+		uint32_t x = c.nonce ^ pos;
+		for (int r = 0; r < smz_boot_rounds(c); r++)
+			x = smz_boot_round(x, c.key[r % 4]);
+		return x;
+	}
+	case SMZ_MODE_TRIVIUM: {
+		uint32_t ks[SMZ_TRIVIUM_LINE_WORDS];
+		smz_trivium_line(c, pos / (4 * SMZ_TRIVIUM_LINE_WORDS), ks);
+		return ks[pos / 4 % SMZ_TRIVIUM_LINE_WORDS];
+	}
+	}
+	return 0;
+}
+
+static void smz_crypt_scalar(const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos)
+{
+	switch (c.mode) {
+	case SMZ_MODE_ADDR:
+		for (size_t i = 0; i < n; i++)
+			words[i] ^= (pos + 4*(uint32_t)i) ^ smz_addr_const;
+		break;
+	case SMZ_MODE_KEY: {
+		uint32_t ks = smz_keystream(c, 0);
+		for (size_t i = 0; i < n; i++)
+			words[i] ^= ks;
+		break;
+	}
+	case SMZ_MODE_BOOT:
+		for (size_t i = 0; i < n; i++)
+			words[i] ^= smz_keystream(c, pos + (uint32_t)i);
+		break;
+	case SMZ_MODE_TRIVIUM: {
+		// one initialization per line, not per word
+		uint32_t ks[SMZ_TRIVIUM_LINE_WORDS];
+		for (size_t i = 0; i < n; i++) {
+			uint32_t a = pos + 4*(uint32_t)i;
+			if (i == 0 || a / 4 % SMZ_TRIVIUM_LINE_WORDS == 0)
+				smz_trivium_line(c, a / (4 * SMZ_TRIVIUM_LINE_WORDS), ks);
+			words[i] ^= ks[a / 4 % SMZ_TRIVIUM_LINE_WORDS];
+		}
+		break;
+	}
+	}
+}
+
+#ifdef SMZ_X86
+
+__attribute__((target("sse2")))
+static inline __m128i smz_rotl_sse2(__m128i x, int n)
+{
+	return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+__attribute__((target("sse2")))
+static void smz_crypt_sse2(const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos)
+{
+	size_t i = 0;
+	__m128i *p = (__m128i*)words;
+
+	switch (c.mode) {
+	case SMZ_MODE_ADDR: {
+		// (a + 16) ^ C != (a ^ C) + 16, so step the address and apply C each time
+		__m128i addr = _mm_add_epi32(_mm_set1_epi32(pos), _mm_setr_epi32(0, 4, 8, 12));
+		__m128i cst = _mm_set1_epi32(smz_addr_const);
+		for (; i + 4 <= n; i += 4, p++) {
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), _mm_xor_si128(addr, cst)));
+			addr = _mm_add_epi32(addr, _mm_set1_epi32(16));
+		}
+		break;
+	}
+	case SMZ_MODE_KEY: {
+		__m128i ks = _mm_set1_epi32(smz_keystream(c, 0));
+		for (; i + 4 <= n; i += 4, p++)
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), ks));
+		break;
+	}
+	case SMZ_MODE_BOOT: {
+		__m128i idx = _mm_add_epi32(_mm_set1_epi32(pos), _mm_setr_epi32(0, 1, 2, 3));
+		__m128i nonce = _mm_set1_epi32(c.nonce);
+		__m128i k[4];
+		for (int r = 0; r < 4; r++)
+			k[r] = _mm_set1_epi32(c.key[r]);
+		for (; i + 4 <= n; i += 4, p++) {
+			__m128i x = _mm_xor_si128(nonce, idx);
+			for (int r = 0; r < smz_boot_rounds(c); r++) {
+				__m128i t = _mm_add_epi32(x, k[r % 4]);
+				x = _mm_xor_si128(_mm_xor_si128(t, smz_rotl_sse2(t, 7)), smz_rotl_sse2(t, 19));
+			}
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), x));
+			idx = _mm_add_epi32(idx, _mm_set1_epi32(4));
+		}
+		break;
+	}
+	case SMZ_MODE_TRIVIUM:
+		// scalar only, see smz_crypt_impl()
+		break;
+	}
+
+	smz_crypt_scalar(c, words + i, n - i, c.mode == SMZ_MODE_BOOT ? pos + (uint32_t)i : pos + 4*(uint32_t)i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i smz_rotl_avx2(__m256i x, int n)
+{
+	return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+__attribute__((target("avx2")))
+static void smz_crypt_avx2(const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos)
+{
+	size_t i = 0;
+	__m256i *p = (__m256i*)words;
+
+	switch (c.mode) {
+	case SMZ_MODE_ADDR: {
+		__m256i addr = _mm256_add_epi32(_mm256_set1_epi32(pos), _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+		__m256i cst = _mm256_set1_epi32(smz_addr_const);
+		for (; i + 8 <= n; i += 8, p++) {
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), _mm256_xor_si256(addr, cst)));
+			addr = _mm256_add_epi32(addr, _mm256_set1_epi32(32));
+		}
+		break;
+	}
+	case SMZ_MODE_KEY: {
+		__m256i ks = _mm256_set1_epi32(smz_keystream(c, 0));
+		for (; i + 8 <= n; i += 8, p++)
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), ks));
+		break;
+	}
+	case SMZ_MODE_BOOT: {
+		__m256i idx = _mm256_add_epi32(_mm256_set1_epi32(pos), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i nonce = _mm256_set1_epi32(c.nonce);
+		__m256i k[4];
+		for (int r = 0; r < 4; r++)
+			k[r] = _mm256_set1_epi32(c.key[r]);
+		for (; i + 8 <= n; i += 8, p++) {
+			__m256i x = _mm256_xor_si256(nonce, idx);
+			for (int r = 0; r < smz_boot_rounds(c); r++) {
+				__m256i t = _mm256_add_epi32(x, k[r % 4]);
+				x = _mm256_xor_si256(_mm256_xor_si256(t, smz_rotl_avx2(t, 7)), smz_rotl_avx2(t, 19));
+			}
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), x));
+			idx = _mm256_add_epi32(idx, _mm256_set1_epi32(8));
+		}
+		break;
+	}
+	case SMZ_MODE_TRIVIUM:
+		// scalar only, see smz_crypt_impl()
+		break;
+	}
+
+	smz_crypt_scalar(c, words + i, n - i, c.mode == SMZ_MODE_BOOT ? pos + (uint32_t)i : pos + 4*(uint32_t)i);
+}
+
+#endif
+
+bool smz_impl_supported(smz_impl impl)
+{
+	switch (impl) {
+	case SMZ_IMPL_SCALAR:
+		return true;
+#ifdef SMZ_X86
+	case SMZ_IMPL_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case SMZ_IMPL_AVX2:
+		return __builtin_cpu_supports("avx2");
+#else
+	default:
+		return false;
+#endif
+	}
+	return false;
+}
+
+smz_impl smz_best_impl()
+{
+	static int best = -1;
+	if (best < 0)
+		best = smz_impl_supported(SMZ_IMPL_AVX2) ? SMZ_IMPL_AVX2 :
+				smz_impl_supported(SMZ_IMPL_SSE2) ? SMZ_IMPL_SSE2 : SMZ_IMPL_SCALAR;
+	return (smz_impl)best;
+}
+
+const char *smz_impl_name(smz_impl impl)
+{
+	switch (impl) {
+	case SMZ_IMPL_SCALAR: return "scalar";
+	case SMZ_IMPL_SSE2:   return "sse2";
+	case SMZ_IMPL_AVX2:   return "avx2";
+	}
+	return "?";
+}
+
+void smz_crypt_impl(smz_impl impl, const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos)
+{
+	// Trivium has no SIMD path: each line is one sequential stream, and the
+	// scalar code already steps 32 bits per word
+	if (c.mode == SMZ_MODE_TRIVIUM || !smz_impl_supported(impl))
+		impl = SMZ_IMPL_SCALAR;
+
+	switch (impl) {
+#ifdef SMZ_X86
+	case SMZ_IMPL_SSE2:
+		smz_crypt_sse2(c, words, n, pos);
+		break;
+	case SMZ_IMPL_AVX2:
+		smz_crypt_avx2(c, words, n, pos);
+		break;
+#endif
+	default:
+		smz_crypt_scalar(c, words, n, pos);
+		break;
+	}
+}
+
+void smz_crypt(const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos)
+{
+	smz_crypt_impl(smz_best_impl(), c, words, n, pos);
+}
+
+void smz_crypt_region(const smz_cipher &c, uint32_t *words, size_t n, uint32_t addr,
+		uint32_t base, uint32_t size)
+{
+	// same 32 bit compare as the RTL: base <= a < base + size
+	uint64_t lo = base, hi = (uint32_t)(base + size);
+	if (hi <= lo)
+		return;
+
+	uint64_t i = lo > addr ? (lo - addr + 3) / 4 : 0;
+	uint64_t j = hi > addr ? (hi - addr + 3) / 4 : 0;
+	if (j > n)
+		j = n;
+	if (i >= j)
+		return;
+
+	uint32_t a = addr + 4*(uint32_t)i;
+	smz_crypt(c, words + i, j - i, c.mode == SMZ_MODE_BOOT ? a / 4 : a);
+}
@@ -0,0 +1,78 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Host implementation of the SMZ ciphers, bit-exact with the RTL:
+//
+//   SMZ_MODE_ADDR  smz_layer.v and axi4_memory in testbench.v
+//                  keystream = byte address ^ 32'h DEADBEEF
+//   SMZ_MODE_KEY   picorv32_smz in picorv32.v
+//                  keystream = smz_key_0 ^ smz_key_1 ^ smz_key_2 ^ smz_key_3
+//   SMZ_MODE_BOOT  picosoc/smz_bootload.v (and smz_mkimage.py), and
+//                  picorv32_smz with CIPHER=1 (picorv32_smz_arx)
+//                  keystream = rounds ARX rounds (4 if 0) over
+//                  nonce ^ word index, round r keyed with key[r % 4]
+//                  (key[0] = KEY[127:96])
+//   SMZ_MODE_TRIVIUM  picorv32_smz with CIPHER=2 (picorv32_smz_trivium)
+//                  keystream = Trivium per line of SMZ_TRIVIUM_LINE_WORDS
+//                  words, key {key[0], key[1], key[2][31:16]}, IV
+//                  {key[2][15:0], key[3], line index}, word i of a line =
+//                  output bits 32*i .. 32*i+31 (first bit in bit 0)
+//
+// All modes XOR the keystream into the data, so encryption and decryption
+// are the same operation. smz_crypt() picks the fastest implementation the
+// host supports (AVX2, SSE2 or scalar); the others stay callable so that
+// smzbench can compare them. SMZ_MODE_TRIVIUM is always scalar.
+
+#ifndef LIBSMZ_H
+#define LIBSMZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum smz_mode {
+	SMZ_MODE_ADDR,
+	SMZ_MODE_KEY,
+	SMZ_MODE_BOOT,
+	SMZ_MODE_TRIVIUM
+};
+
+#define SMZ_TRIVIUM_LINE_WORDS 8
+
+struct smz_cipher {
+	smz_mode mode;
+	uint32_t key[4];
+	uint32_t nonce;
+	uint32_t rounds;  // SMZ_MODE_BOOT: CIPHER_ROUNDS, 0 for the 4 of smz_bootload.v
+};
+
+enum smz_impl {
+	SMZ_IMPL_SCALAR,
+	SMZ_IMPL_SSE2,
+	SMZ_IMPL_AVX2
+};
+
+// keystream word at pos, the byte address (SMZ_MODE_ADDR, SMZ_MODE_TRIVIUM)
+// or the payload word index (SMZ_MODE_BOOT), unused for SMZ_MODE_KEY
+uint32_t smz_keystream(const smz_cipher &c, uint32_t pos);
+
+// en-/decrypt n words in place, words[i] is at pos + 4*i (SMZ_MODE_ADDR,
+// SMZ_MODE_TRIVIUM) or has index pos + i (SMZ_MODE_BOOT)
+void smz_crypt(const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos);
+void smz_crypt_impl(smz_impl impl, const smz_cipher &c, uint32_t *words, size_t n, uint32_t pos);
+
+// en-/decrypt the part of a memory image at byte address addr that lies
+// in the secure region [base, base + size), the rest is left unchanged;
+// SMZ_MODE_BOOT uses the absolute word index addr / 4, as picorv32_smz
+void smz_crypt_region(const smz_cipher &c, uint32_t *words, size_t n, uint32_t addr,
+		uint32_t base, uint32_t size);
+
+// best implementation supported by the host, and whether impl is supported
+smz_impl smz_best_impl();
+bool smz_impl_supported(smz_impl impl);
+const char *smz_impl_name(smz_impl impl);
+
+#endif
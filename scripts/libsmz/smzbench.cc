@@ -0,0 +1,178 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Throughput benchmark and self-check for libsmz:
+//
+//   smzbench [megabytes]
+//
+// Checks the boot keystream against known answers from smz_mkimage.py and
+// Trivium against its published test vector, then for every mode checks
+// that each SIMD implementation matches the scalar one for all alignments
+// and tail lengths, and measures MB/s on a buffer of the given size
+// (default 64 MB).
+
+#include "libsmz.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const char *mode_names[] = { "addr", "key", "boot", "trivium" };
+
+static uint64_t xorshift64(uint64_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static smz_cipher default_cipher(smz_mode mode)
+{
+	// defaults of smz_bootload.v / smz_mkimage.py
+	smz_cipher c = { mode, { 0x0f1e2d3c, 0x4b5a6978, 0x8796a5b4, 0xc3d2e1f0 }, 0x5a17c0de };
+	return c;
+}
+
+static int check_known_answers()
+{
+	static const uint32_t boot_ks[][2] = {
+		{ 0x00000000, 0xda7fbeee }, { 0x00000001, 0xa64feff3 }, { 0x00000002, 0xece245c3 },
+		{ 0x000003e8, 0x3babb2d0 }, { 0xffffffff, 0xe26b2453 }
+	};
+	int errors = 0;
+
+	smz_cipher boot = default_cipher(SMZ_MODE_BOOT);
+	for (auto &v : boot_ks)
+		if (smz_keystream(boot, v[0]) != v[1]) {
+			printf("boot keystream[%08x] = %08x, expected %08x\n", v[0], smz_keystream(boot, v[0]), v[1]);
+			errors++;
+		}
+
+	// 8 rounds (CIPHER_ROUNDS=8) are the 4 round keystream applied twice
+	smz_cipher boot8 = boot;
+	boot8.rounds = 8;
+	for (auto &v : boot_ks)
+		if (smz_keystream(boot8, v[0]) != smz_keystream(boot, v[1] ^ boot.nonce)) {
+			printf("boot keystream[%08x] with 8 rounds = %08x\n", v[0], smz_keystream(boot8, v[0]));
+			errors++;
+		}
+
+	// in a region the boot mode uses the absolute word index, as picorv32_smz
+	uint32_t boot_words[4] = { };
+	smz_crypt_region(boot, boot_words, 4, 0x0ffffff8, 0x10000000, 8);
+	for (int i = 0; i < 4; i++)
+		if (boot_words[i] != (i >= 2 ? smz_keystream(boot, 0x0ffffff8 / 4 + i) : 0)) {
+			printf("boot region word %d = %08x\n", i, boot_words[i]);
+			errors++;
+		}
+
+	smz_cipher addr = default_cipher(SMZ_MODE_ADDR);
+	if (smz_keystream(addr, 0x00010004) != 0xDEACBEEB) {
+		printf("addr keystream[00010004] = %08x, expected deacbeeb\n", smz_keystream(addr, 0x00010004));
+		errors++;
+	}
+
+	// only the two words at 0x10000000 and 0x10000004 are in the region
+	uint32_t words[6] = { };
+	smz_crypt_region(addr, words, 6, 0x0ffffff8, 0x10000000, 8);
+	for (int i = 0; i < 6; i++)
+		if (words[i] != (i == 2 || i == 3 ? smz_keystream(addr, 0x0ffffff8 + 4*i) : 0)) {
+			printf("region word %d = %08x\n", i, words[i]);
+			errors++;
+		}
+
+	smz_cipher key = default_cipher(SMZ_MODE_KEY);
+	if (smz_keystream(key, 0) != (0x0f1e2d3c ^ 0x4b5a6978 ^ 0x8796a5b4 ^ 0xc3d2e1f0)) {
+		printf("key keystream = %08x\n", smz_keystream(key, 0));
+		errors++;
+	}
+
+	// all-zero key and IV: the published Trivium output FBE0BF26 5859051B
+	smz_cipher trivium = { SMZ_MODE_TRIVIUM, { }, 0 };
+	if (smz_keystream(trivium, 0) != 0x26bfe0fb || smz_keystream(trivium, 4) != 0x1b055958) {
+		printf("trivium keystream = %08x %08x\n", smz_keystream(trivium, 0), smz_keystream(trivium, 4));
+		errors++;
+	}
+
+	return errors;
+}
+
+static int check_impl(smz_impl impl, const smz_cipher &c)
+{
+	uint64_t rng = 1;
+	uint32_t ref[64], buf[64];
+	int errors = 0;
+
+	for (int offset = 0; offset < 8; offset++)
+	for (int n = 0; n + offset <= 64; n++) {
+		uint32_t pos = (uint32_t)xorshift64(rng);
+		for (int i = 0; i < 64; i++)
+			ref[i] = buf[i] = (uint32_t)xorshift64(rng);
+		smz_crypt_impl(SMZ_IMPL_SCALAR, c, ref + offset, n, pos);
+		smz_crypt_impl(impl, c, buf + offset, n, pos);
+		if (memcmp(ref, buf, sizeof(ref))) {
+			if (!errors)
+				printf("%s/%s differs from scalar (offset %d, %d words, pos %08x)\n",
+						smz_impl_name(impl), mode_names[c.mode], offset, n, pos);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 0) : 64;
+	size_t n = megabytes * 1024 * 1024 / 4;
+	std::vector<uint32_t> buf(n);
+	uint64_t rng = 88172645463325252ULL;
+	int errors = check_known_answers();
+
+	for (size_t i = 0; i < n; i++)
+		buf[i] = (uint32_t)xorshift64(rng);
+
+	printf("best implementation: %s\n", smz_impl_name(smz_best_impl()));
+	printf("%-6s %-6s %10s\n", "impl", "mode", "MB/s");
+
+	for (int impl = SMZ_IMPL_SCALAR; impl <= SMZ_IMPL_AVX2; impl++) {
+		if (!smz_impl_supported((smz_impl)impl))
+			continue;
+		for (int mode = SMZ_MODE_ADDR; mode <= SMZ_MODE_TRIVIUM; mode++) {
+			// Trivium is scalar only (smz_crypt_impl)
+			if (mode == SMZ_MODE_TRIVIUM && impl != SMZ_IMPL_SCALAR)
+				continue;
+			smz_cipher c = default_cipher((smz_mode)mode);
+			errors += check_impl((smz_impl)impl, c);
+			if (mode == SMZ_MODE_BOOT) {
+				smz_cipher c6 = c;
+				c6.rounds = 6;
+				errors += check_impl((smz_impl)impl, c6);
+			}
+
+			int rounds = 0;
+			auto t0 = std::chrono::steady_clock::now();
+			double seconds;
+			do {
+				smz_crypt_impl((smz_impl)impl, c, buf.data(), n, 0);
+				rounds++;
+				seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			} while (seconds < 0.5);
+			printf("%-6s %-6s %10.1f\n", smz_impl_name((smz_impl)impl), mode_names[mode],
+					rounds * megabytes / seconds);
+		}
+	}
+
+	if (errors) {
+		printf("%d ERRORS.\n", errors);
+		return 1;
+	}
+	printf("ALL CHECKS PASSED.\n");
+	return 0;
+}
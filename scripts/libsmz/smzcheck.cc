@@ -0,0 +1,640 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Cross-check of libsmz against the RTL (smzcheck.v): random accesses
+// around the secure region boundaries for smz_layer and picorv32_smz, random
+// writes through the ARX cipher of picorv32_smz on clk2x and through its
+// Trivium cipher, reads and writes through its ECC stage with injected
+// single and double bit errors and through its 64 bit memory bus (with the
+// memory request held while the memory stalls it), and a complete image
+// built with libsmz streamed through smz_bootload.
+
+#include "Vsmzcheck.h"
+#include "verilated.h"
+#include "libsmz.h"
+#include <stdio.h>
+#include <vector>
+
+static const uint32_t boot_image_addr = 0x100000;   // smz_bootload IMAGE_ADDR
+static const uint32_t boot_magic = 0x425a4d53;
+
+static uint64_t xorshift64(uint64_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static uint32_t expect(const smz_cipher &c, uint32_t addr, uint32_t data, uint32_t base, uint32_t size, bool enable)
+{
+	if (enable)
+		smz_crypt_region(c, &data, 1, addr, base, size);
+	return data;
+}
+
+static int check_access(Vsmzcheck *top, uint64_t &rng, int count)
+{
+	smz_cipher addr_mode = { SMZ_MODE_ADDR, { }, 0 };
+	smz_cipher key_mode = { SMZ_MODE_KEY, { }, 0 };
+	int errors = 0;
+
+	for (int i = 0; i < count; i++) {
+		uint32_t base = (uint32_t)xorshift64(rng) & ~3;
+		uint32_t size = (uint32_t)xorshift64(rng) % 4096 * 4;
+		bool enable = xorshift64(rng) % 8;
+		uint32_t addr = (uint32_t)xorshift64(rng) & ~3;
+		switch (xorshift64(rng) % 4) {
+			case 0: addr = base + 4 * (xorshift64(rng) % 64) - 128; break;
+			case 1: addr = base + size + 4 * (xorshift64(rng) % 64) - 128; break;
+			case 2: addr = 0x10000 + 4 * (xorshift64(rng) % 0x8000) - 128; break;
+		}
+		for (int k = 0; k < 4; k++)
+			key_mode.key[k] = (uint32_t)xorshift64(rng);
+
+		top->addr = addr;
+		top->wdata = (uint32_t)xorshift64(rng);
+		top->rdata = (uint32_t)xorshift64(rng);
+		top->smz_base = base;
+		top->smz_size = size;
+		top->smz_enable = enable;
+		top->smz_key_0 = key_mode.key[0];
+		top->smz_key_1 = key_mode.key[1];
+		top->smz_key_2 = key_mode.key[2];
+		top->smz_key_3 = key_mode.key[3];
+		top->clk = 0;
+		top->eval();
+
+		uint32_t layer_wdata = expect(addr_mode, addr, top->wdata, base, size, enable);
+		uint32_t layer_rdata = expect(addr_mode, addr, top->rdata, base, size, enable);
+		uint32_t smz_wdata = expect(key_mode, addr, top->wdata, 0x10000, 0x10000, true);
+		uint32_t smz_rdata = expect(key_mode, addr, top->rdata, 0x10000, 0x10000, true);
+
+		if (top->layer_wdata != layer_wdata || top->layer_rdata != layer_rdata || top->smz_wdata != smz_wdata) {
+			if (errors++ < 10)
+				printf("addr=%08x base=%08x size=%08x en=%d: layer %08x/%08x (libsmz %08x/%08x) smz wdata %08x (libsmz %08x)\n",
+						addr, base, size, enable, top->layer_wdata, top->layer_rdata, layer_wdata, layer_rdata,
+						top->smz_wdata, smz_wdata);
+		}
+
+		// picorv32_smz registers the read data
+		top->clk = 1;
+		top->eval();
+		if (top->smz_rdata != smz_rdata) {
+			if (errors++ < 10)
+				printf("addr=%08x: smz rdata %08x (libsmz %08x)\n", addr, top->smz_rdata, smz_rdata);
+		}
+	}
+
+	return errors;
+}
+
+// one CPU cycle, clk2x rising with clk and in the middle of it
+static void tick2x(Vsmzcheck *top)
+{
+	top->clk = 1;
+	top->clk2x = 1;
+	top->eval();
+	top->clk2x = 0;
+	top->eval();
+	top->clk = 0;
+	top->clk2x = 1;
+	top->eval();
+	top->clk2x = 0;
+	top->eval();
+}
+
+static int check_arx(Vsmzcheck *top, uint64_t &rng, int count)
+{
+	// CIPHER_ROUNDS of the arx instance in smzcheck.v
+	smz_cipher c = { SMZ_MODE_BOOT, { }, 0, 6 };
+	int errors = 0;
+
+	top->arx_valid = 0;
+	top->resetn = 0;
+	tick2x(top);
+	tick2x(top);
+	top->resetn = 1;
+
+	for (int i = 0; i < count; i++) {
+		uint32_t addr = 0x10000 + 4 * (xorshift64(rng) % 0x4000);
+		for (int k = 0; k < 4; k++)
+			c.key[k] = (uint32_t)xorshift64(rng);
+
+		top->arx_addr = addr;
+		top->arx_valid = 1;
+		top->smz_key_0 = c.key[0];
+		top->smz_key_1 = c.key[1];
+		top->smz_key_2 = c.key[2];
+		top->smz_key_3 = c.key[3];
+
+		// the request is registered in the first cycle, the 6 rounds take
+		// three more on clk2x
+		int cycles = 0;
+		for (top->eval(); !top->arx_ready && cycles < 100; top->eval()) {
+			tick2x(top);
+			cycles++;
+		}
+
+		uint32_t ks = smz_keystream(c, addr / 4);
+		if ((!top->arx_ready || top->arx_wdata != ks || cycles != 4) && errors++ < 10)
+			printf("addr=%08x: arx ready=%d after %d cycles, wdata %08x (libsmz %08x)\n",
+					addr, top->arx_ready, cycles, top->arx_wdata, ks);
+
+		tick2x(top);
+		top->arx_valid = 0;
+		tick2x(top);
+	}
+
+	return errors;
+}
+
+static int check_trivium(Vsmzcheck *top, uint64_t &rng, int count)
+{
+	smz_cipher c = { SMZ_MODE_TRIVIUM, { }, 0 };
+	// the line and next word the engine holds the state for
+	uint32_t line = 0, engine_line = ~0u, next_word = 0;
+	int errors = 0;
+
+	top->triv_valid = 0;
+	top->resetn = 0;
+	tick2x(top);
+	tick2x(top);
+	top->resetn = 1;
+
+	for (int i = 0; i < count; i++) {
+		// mostly forward within a line, sometimes a new line or key
+		uint32_t word = xorshift64(rng) % SMZ_TRIVIUM_LINE_WORDS;
+		if (i % 64 == 0) {
+			for (int k = 0; k < 4; k++)
+				c.key[k] = (uint32_t)xorshift64(rng);
+			engine_line = ~0u;
+		}
+		if (xorshift64(rng) % 4 == 0)
+			line = xorshift64(rng) % (0x10000 / 4 / SMZ_TRIVIUM_LINE_WORDS);
+		else if (next_word < SMZ_TRIVIUM_LINE_WORDS && xorshift64(rng) % 2)
+			word = next_word;
+		uint32_t addr = 0x10000 + 4 * (line * SMZ_TRIVIUM_LINE_WORDS + word);
+
+		// request cycle, then one round per word from the engine position,
+		// or the load, 36 initialization rounds and one per word from the
+		// line start
+		bool seq = line == engine_line && word >= next_word;
+		int expected = seq ? 2 + (int)(word - next_word) : 39 + (int)word;
+
+		top->triv_addr = addr;
+		top->triv_valid = 1;
+		top->smz_key_0 = c.key[0];
+		top->smz_key_1 = c.key[1];
+		top->smz_key_2 = c.key[2];
+		top->smz_key_3 = c.key[3];
+
+		int cycles = 0;
+		for (top->eval(); !top->triv_ready && cycles < 1000; top->eval()) {
+			tick2x(top);
+			cycles++;
+		}
+
+		uint32_t ks = smz_keystream(c, addr);
+		if ((!top->triv_ready || top->triv_wdata != ks || cycles != expected) && errors++ < 10)
+			printf("addr=%08x: trivium ready=%d after %d cycles (expected %d), wdata %08x (libsmz %08x)\n",
+					addr, top->triv_ready, cycles, expected, top->triv_wdata, ks);
+
+		engine_line = line;
+		next_word = word + 1;
+		tick2x(top);
+		top->triv_valid = 0;
+		tick2x(top);
+	}
+
+	return errors;
+}
+
+static uint32_t merge(uint32_t old, uint32_t data, uint32_t wstrb)
+{
+	uint32_t mask = 0;
+	for (int i = 0; i < 4; i++)
+		if (wstrb & (1 << i))
+			mask |= 0xffu << (8 * i);
+	return (old & ~mask) | (data & mask);
+}
+
+// memory behind the ECC instance: the 64 words below the secure region and
+// the first 64 of it, data and check bits as stored
+struct ecc_word {
+	uint32_t data;
+	uint32_t check;
+};
+
+static const uint32_t ecc_mem_base = 0x10000 - 256;
+
+static void ecc_flip(ecc_word &w, int bit)
+{
+	if (bit < 32)
+		w.data ^= 1u << bit;
+	else
+		w.check ^= 1u << (bit - 32);
+}
+
+// one access through the ECC instance, the memory answering after 0 to 7
+// cycles, so before or after the keystream; returns false if cpu_mem_ready
+// never came
+static bool ecc_access(Vsmzcheck *top, uint64_t &rng, std::vector<ecc_word> &mem, uint32_t addr,
+		uint32_t wdata, uint32_t wstrb, uint32_t &rdata, int &event, int &mem_reads, int &mem_writes)
+{
+	top->ecc_addr = addr;
+	top->ecc_wdata = wdata;
+	top->ecc_wstrb = wstrb;
+	top->ecc_valid = 1;
+	mem_reads = mem_writes = 0;
+
+	bool ready = false;
+	int delay = xorshift64(rng) % 8;
+	for (int cycles = 0; !ready && cycles < 100; cycles++) {
+		top->clk = 0;
+		top->ecc_mem_ready = 0;
+		top->eval();
+		if (top->ecc_mem_valid && delay-- <= 0) {
+			ecc_word &w = mem[(top->ecc_mem_addr - ecc_mem_base) / 4 % mem.size()];
+			top->ecc_mem_ready = 1;
+			top->ecc_mem_rdata = w.data;
+			top->ecc_mem_rcheck = w.check;
+			top->eval();
+			if (top->ecc_mem_wstrb) {
+				w.data = merge(w.data, top->ecc_mem_wdata, top->ecc_mem_wstrb);
+				w.check = top->ecc_mem_wcheck;
+				mem_writes++;
+			} else
+				mem_reads++;
+			delay = xorshift64(rng) % 8;
+		}
+		ready = top->ecc_ready;
+		rdata = top->ecc_rdata;
+		event = top->ecc_event;
+		top->clk = 1;
+		top->eval();
+	}
+
+	top->ecc_valid = 0;
+	top->ecc_mem_ready = 0;
+	top->clk = 0;
+	top->eval();
+	top->clk = 1;
+	top->eval();
+	return ready;
+}
+
+static int check_ecc(Vsmzcheck *top, uint64_t &rng, int count)
+{
+	smz_cipher c = { SMZ_MODE_BOOT, { }, 0 };
+	std::vector<ecc_word> mem(128, ecc_word { 0, 0 });
+	std::vector<uint32_t> plain(128);
+	// bit errors injected into the stored word since it was last written
+	std::vector<int> flips(128, 0);
+	int errors = 0;
+
+	for (int k = 0; k < 4; k++)
+		c.key[k] = (uint32_t)xorshift64(rng);
+	// zero data has zero check bits, so the initial memory is valid
+	for (uint32_t i = 0; i < 128; i++)
+		plain[i] = i < 64 ? 0 : smz_keystream(c, (ecc_mem_base + 4 * i) / 4);
+
+	top->smz_key_0 = c.key[0];
+	top->smz_key_1 = c.key[1];
+	top->smz_key_2 = c.key[2];
+	top->smz_key_3 = c.key[3];
+	top->ecc_valid = 0;
+	top->ecc_mem_ready = 0;
+	top->resetn = 0;
+	for (int i = 0; i < 2; i++) {
+		top->clk = 0;
+		top->eval();
+		top->clk = 1;
+		top->eval();
+	}
+	top->resetn = 1;
+
+	static const uint32_t partial[] = { 1, 2, 4, 8, 3, 12 };
+
+	for (int i = 0; i < count; i++) {
+		uint32_t idx = xorshift64(rng) % 128;
+		uint32_t addr = ecc_mem_base + 4 * idx;
+		bool secure = idx >= 64;
+
+		if (secure && !flips[idx] && xorshift64(rng) % 4 == 0) {
+			int bit = xorshift64(rng) % 39;
+			flips[idx] = xorshift64(rng) % 3 ? 1 : 2;
+			ecc_flip(mem[idx], bit);
+			if (flips[idx] == 2)
+				ecc_flip(mem[idx], (bit + 1 + xorshift64(rng) % 38) % 39);
+		}
+
+		// a word with a double error is read, then rewritten whole
+		uint32_t wstrb = 0;
+		if (flips[idx] != 2 && xorshift64(rng) % 2)
+			wstrb = xorshift64(rng) % 2 ? 15 : partial[xorshift64(rng) % 6];
+		uint32_t wdata = (uint32_t)xorshift64(rng);
+		bool checked = secure && wstrb != 15;
+		int expected_event = checked ? flips[idx] : 0;
+
+		uint32_t rdata;
+		int event, mem_reads, mem_writes;
+		bool ready = ecc_access(top, rng, mem, addr, wdata, wstrb, rdata, event, mem_reads, mem_writes);
+
+		bool ok = ready && event == expected_event;
+		if (!wstrb) {
+			ok = ok && (flips[idx] == 2 || rdata == plain[idx]) && mem_reads == 1 && !mem_writes;
+		} else {
+			plain[idx] = merge(plain[idx], wdata, wstrb);
+			flips[idx] = 0;
+			uint32_t stored = secure ? plain[idx] ^ smz_keystream(c, addr / 4) : plain[idx];
+			ok = ok && mem[idx].data == stored && mem_writes == 1 && mem_reads == (checked && wstrb != 15);
+		}
+		if (!ok && errors++ < 10)
+			printf("addr=%08x wstrb=%x flips=%d: ecc ready=%d event=%d (expected %d) rdata %08x (expected %08x), "
+					"%d memory reads, %d writes\n", addr, wstrb, flips[idx], ready, event, expected_event,
+					rdata, plain[idx], mem_reads, mem_writes);
+
+		if (flips[idx] == 2) {
+			wdata = (uint32_t)xorshift64(rng);
+			ecc_access(top, rng, mem, addr, wdata, 15, rdata, event, mem_reads, mem_writes);
+			plain[idx] = wdata;
+			flips[idx] = 0;
+		}
+	}
+
+	return errors;
+}
+
+// one access through the 64 bit bus instance, memory as for ecc_access;
+// stable is cleared if a memory request the memory stalled was dropped or
+// changed before it was accepted
+static bool wide_access(Vsmzcheck *top, uint64_t &rng, std::vector<uint32_t> &mem, uint32_t addr,
+		uint32_t wdata, uint32_t wstrb, uint32_t &rdata, int &mem_reads, int &mem_writes, bool &stable)
+{
+	top->wide_addr = addr;
+	top->wide_wdata = wdata;
+	top->wide_wstrb = wstrb;
+	top->wide_valid = 1;
+	mem_reads = mem_writes = 0;
+	stable = true;
+
+	bool ready = false, stalled = false;
+	uint32_t stalled_addr = 0, stalled_wstrb = 0;
+	uint64_t stalled_wdata = 0;
+	int delay = xorshift64(rng) % 4;
+	for (int cycles = 0; !ready && cycles < 1000; cycles++) {
+		top->clk = 0;
+		top->wide_mem_ready = 0;
+		top->eval();
+		if (stalled && (!top->wide_mem_valid || top->wide_mem_addr != stalled_addr ||
+				top->wide_mem_wdata != stalled_wdata || top->wide_mem_wstrb != stalled_wstrb))
+			stable = false;
+		stalled = top->wide_mem_valid;
+		stalled_addr = top->wide_mem_addr;
+		stalled_wdata = top->wide_mem_wdata;
+		stalled_wstrb = top->wide_mem_wstrb;
+		if (top->wide_mem_valid && delay-- <= 0) {
+			stalled = false;
+			uint32_t idx = (top->wide_mem_addr - ecc_mem_base) / 4 % mem.size() & ~1;
+			top->wide_mem_ready = 1;
+			top->wide_mem_rdata = mem[idx] | (uint64_t)mem[idx + 1] << 32;
+			top->eval();
+			if (top->wide_mem_wstrb) {
+				mem[idx] = merge(mem[idx], top->wide_mem_wdata, top->wide_mem_wstrb & 15);
+				mem[idx + 1] = merge(mem[idx + 1], top->wide_mem_wdata >> 32, top->wide_mem_wstrb >> 4);
+				mem_writes++;
+			} else
+				mem_reads++;
+			delay = xorshift64(rng) % 4;
+		}
+		ready = top->wide_ready;
+		rdata = top->wide_rdata;
+		top->clk = 1;
+		top->eval();
+	}
+
+	top->wide_valid = 0;
+	top->wide_mem_ready = 0;
+	top->clk = 0;
+	top->eval();
+	top->clk = 1;
+	top->eval();
+	return ready;
+}
+
+static int check_wide(Vsmzcheck *top, uint64_t &rng, int count)
+{
+	smz_cipher c = { SMZ_MODE_TRIVIUM, { }, 0 };
+	std::vector<uint32_t> mem(128, 0), plain(128);
+	int errors = 0;
+
+	for (int k = 0; k < 4; k++)
+		c.key[k] = (uint32_t)xorshift64(rng);
+	for (uint32_t i = 0; i < 128; i++)
+		plain[i] = i < 64 ? 0 : smz_keystream(c, ecc_mem_base + 4 * i);
+
+	top->smz_key_0 = c.key[0];
+	top->smz_key_1 = c.key[1];
+	top->smz_key_2 = c.key[2];
+	top->smz_key_3 = c.key[3];
+	top->wide_valid = 0;
+	top->wide_mem_ready = 0;
+	top->resetn = 0;
+	for (int i = 0; i < 2; i++) {
+		top->clk = 0;
+		top->eval();
+		top->clk = 1;
+		top->eval();
+	}
+	top->resetn = 1;
+
+	// what the SMZ keeps of the doubleword buf_dw: 0 nothing, 1 the
+	// plaintext, 2 the plaintext or the ciphertext being decrypted, 3 either
+	// of those or nothing (a store raced the decryption)
+	uint32_t buf_dw = ~0u, idx = 64;
+	int buf_state[2] = { 0, 0 };
+	static const uint32_t partial[] = { 1, 2, 4, 8, 3, 12 };
+
+	for (int i = 0; i < count; i++) {
+		// mostly sequential
+		idx = xorshift64(rng) % 4 ? (idx + 1) % 128 : xorshift64(rng) % 128;
+		uint32_t addr = ecc_mem_base + 4 * idx;
+		bool secure = idx >= 64;
+		uint32_t wstrb = 0;
+		if (xorshift64(rng) % 4 == 0)
+			wstrb = xorshift64(rng) % 2 ? 15 : partial[xorshift64(rng) % 6];
+		uint32_t wdata = (uint32_t)xorshift64(rng);
+
+		uint32_t rdata;
+		int mem_reads, mem_writes;
+		bool stable;
+		bool ready = wide_access(top, rng, mem, addr, wdata, wstrb, rdata, mem_reads, mem_writes, stable);
+
+		bool ok = ready && stable;
+		int *state = &buf_state[idx & 1];
+		bool buffered = secure && buf_dw == idx / 2;
+		if (!wstrb) {
+			ok = ok && rdata == plain[idx] && !mem_writes;
+			if (!secure || !buffered || !*state)
+				ok = ok && mem_reads == 1;
+			else if (*state != 3)
+				ok = ok && mem_reads == 0;
+			if (secure) {
+				if (!buffered) {
+					buf_dw = idx / 2;
+					buf_state[0] = buf_state[1] = 0;
+				}
+				*state = 1;
+				if (!(idx & 1) && !buf_state[1])
+					buf_state[1] = 2;
+			}
+		} else {
+			plain[idx] = merge(plain[idx], wdata, wstrb);
+			if (buffered && (idx & 1) && *state == 2)
+				*state = 3;
+			ok = ok && mem_writes == 1 && !mem_reads;
+			for (uint32_t k = idx & ~1; k <= (idx | 1); k++)
+				ok = ok && mem[k] == (k < 64 ? plain[k] : plain[k] ^ smz_keystream(c, ecc_mem_base + 4 * k));
+		}
+		if (!ok && errors++ < 10)
+			printf("addr=%08x wstrb=%x: wide ready=%d stable=%d rdata %08x (expected %08x), %d memory reads, %d writes\n",
+					addr, wstrb, ready, stable, rdata, plain[idx], mem_reads, mem_writes);
+	}
+
+	// a key change drops the kept plaintext: after reading both words of a
+	// secure doubleword, both are read from memory again and decrypted with
+	// the new key
+	for (int i = 0; i < 16; i++) {
+		uint32_t idx = 64 + 2 * (xorshift64(rng) % 32);
+		uint32_t rdata;
+		int mem_reads, mem_writes;
+		bool stable;
+		wide_access(top, rng, mem, ecc_mem_base + 4 * idx, 0, 0, rdata, mem_reads, mem_writes, stable);
+		wide_access(top, rng, mem, ecc_mem_base + 4 * idx + 4, 0, 0, rdata, mem_reads, mem_writes, stable);
+
+		for (int k = 0; k < 4; k++)
+			c.key[k] = (uint32_t)xorshift64(rng);
+		top->smz_key_0 = c.key[0];
+		top->smz_key_1 = c.key[1];
+		top->smz_key_2 = c.key[2];
+		top->smz_key_3 = c.key[3];
+
+		for (uint32_t k : { idx + 1, idx }) {
+			uint32_t addr = ecc_mem_base + 4 * k;
+			uint32_t expected = mem[k] ^ smz_keystream(c, addr);
+			bool ready = wide_access(top, rng, mem, addr, 0, 0, rdata, mem_reads, mem_writes, stable);
+			if ((!ready || rdata != expected || mem_reads != 1) && errors++ < 10)
+				printf("addr=%08x after a key change: wide ready=%d rdata %08x (expected %08x), %d memory reads\n",
+						addr, ready, rdata, expected, mem_reads);
+		}
+	}
+
+	return errors;
+}
+
+// streams image through smz_bootload, returns the number of RAM writes
+static int run_boot(Vsmzcheck *top, const std::vector<uint32_t> &image, std::vector<uint32_t> &ram)
+{
+	bool pending = false;
+	int writes = 0;
+	top->resetn = 0;
+	for (int cycle = 0; cycle < 100000 && !top->boot_done; cycle++) {
+		uint32_t idx = (top->flash_addr - boot_image_addr) / 4;
+		top->clk = 0;
+		top->resetn = cycle >= 4;
+		top->flash_ready = pending;
+		top->flash_rdata = pending && idx < image.size() ? image[idx] : 0;
+		top->eval();
+		if (top->ram_we) {
+			writes++;
+			if (top->ram_addr < ram.size())
+				ram[top->ram_addr] = top->ram_wdata;
+		}
+		pending = top->resetn && top->flash_valid && !top->flash_ready;
+		top->clk = 1;
+		top->eval();
+	}
+	return writes;
+}
+
+static int check_boot(Vsmzcheck *top, uint64_t &rng, uint32_t nwords)
+{
+	smz_cipher c = { SMZ_MODE_BOOT, { 0x0f1e2d3c, 0x4b5a6978, 0x8796a5b4, 0xc3d2e1f0 }, (uint32_t)xorshift64(rng) };
+	std::vector<uint32_t> payload(nwords), ram(1024, 0);
+	for (auto &w : payload)
+		w = (uint32_t)xorshift64(rng);
+
+	std::vector<uint32_t> image = { boot_magic, nwords, 0, c.nonce };
+	image.insert(image.end(), payload.begin(), payload.end());
+	smz_crypt(c, image.data() + 4, nwords, 0);
+	run_boot(top, image, ram);
+
+	int errors = 0;
+	for (uint32_t i = 0; i < nwords; i++)
+		if (ram[i] != payload[i] && errors++ < 10)
+			printf("boot word %u: %08x, expected %08x\n", i, ram[i], payload[i]);
+	if (!top->boot_done) {
+		printf("smz_bootload did not finish.\n");
+		errors++;
+	}
+
+	// headers that do not fit the 1024 word RAM, the last two only when
+	// load address and size are checked without a wrapping 32 bit sum
+	static const uint32_t bad_headers[][2] = {
+		{ 0x00000ffc, 2 }, { 0x00001000, 1 }, { 0xfffffffc, 0xc0000001 }, { 0x00000004, 0xffffffff }
+	};
+	for (auto &h : bad_headers) {
+		image = { boot_magic, h[1], h[0], c.nonce, 0, 0, 0, 0 };
+		int writes = run_boot(top, image, ram);
+		if ((!top->boot_done || writes) && errors++ < 10)
+			printf("smz_bootload load=%08x words=%08x: done=%d, %d RAM writes (expected a rejected header)\n",
+					h[0], h[1], top->boot_done, writes);
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	Verilated::commandArgs(argc, argv);
+	Vsmzcheck *top = new Vsmzcheck;
+	uint64_t rng = 88172645463325252ULL;
+
+	top->resetn = 1;
+	int errors = check_access(top, rng, 100000);
+	printf("smz_layer, picorv32_smz: %d errors\n", errors);
+
+	int arx_errors = check_arx(top, rng, 10000);
+	printf("picorv32_smz arx: %d errors\n", arx_errors);
+	errors += arx_errors;
+
+	int trivium_errors = check_trivium(top, rng, 10000);
+	printf("picorv32_smz trivium: %d errors\n", trivium_errors);
+	errors += trivium_errors;
+
+	int ecc_errors = check_ecc(top, rng, 10000);
+	printf("picorv32_smz ecc: %d errors\n", ecc_errors);
+	errors += ecc_errors;
+
+	int wide_errors = check_wide(top, rng, 10000);
+	printf("picorv32_smz 64 bit bus: %d errors\n", wide_errors);
+	errors += wide_errors;
+
+	int boot_errors = check_boot(top, rng, 1000);
+	printf("smz_bootload: %d errors\n", boot_errors);
+	errors += boot_errors;
+
+	top->final();
+	delete top;
+
+	if (errors) {
+		printf("ERROR!\n");
+		return 1;
+	}
+	printf("ALL CHECKS PASSED.\n");
+	return 0;
+}
@@ -0,0 +1,251 @@
+// Verilator top for smzcheck.cc: the SMZ cipher blocks of the tree side by
+// side, so that libsmz can be checked against each of them.
+
+module smzcheck (
+	input clk,
+	input resetn,
+
+	// smz_layer (SMZ_MODE_ADDR) and picorv32_smz (SMZ_MODE_KEY)
+	input  [31:0] addr,
+	input  [31:0] wdata,
+	input  [31:0] rdata,
+	input  [31:0] smz_base,
+	input  [31:0] smz_size,
+	input         smz_enable,
+	input  [31:0] smz_key_0,
+	input  [31:0] smz_key_1,
+	input  [31:0] smz_key_2,
+	input  [31:0] smz_key_3,
+
+	output [31:0] layer_wdata,
+	output [31:0] layer_rdata,
+	output [31:0] smz_wdata,
+	output [31:0] smz_rdata,
+
+	// picorv32_smz with the ARX cipher on clk2x (SMZ_MODE_BOOT, nonce 0)
+	input         clk2x,
+	input         arx_valid,
+	input  [31:0] arx_addr,
+	output        arx_ready,
+	output [31:0] arx_wdata,
+
+	// picorv32_smz with Trivium on clk (SMZ_MODE_TRIVIUM)
+	input         triv_valid,
+	input  [31:0] triv_addr,
+	output        triv_ready,
+	output [31:0] triv_wdata,
+
+	// picorv32_smz with the ARX cipher and ENABLE_ECC on clk, both sides
+	input         ecc_valid,
+	input  [31:0] ecc_addr,
+	input  [31:0] ecc_wdata,
+	input  [ 3:0] ecc_wstrb,
+	output [31:0] ecc_rdata,
+	output        ecc_ready,
+	output [ 1:0] ecc_event,
+	output        ecc_mem_valid,
+	output [31:0] ecc_mem_addr,
+	output [31:0] ecc_mem_wdata,
+	output [ 3:0] ecc_mem_wstrb,
+	output [ 6:0] ecc_mem_wcheck,
+	input  [31:0] ecc_mem_rdata,
+	input  [ 6:0] ecc_mem_rcheck,
+	input         ecc_mem_ready,
+
+	// picorv32_smz with Trivium and a 64 bit memory bus on clk, both sides
+	input         wide_valid,
+	input  [31:0] wide_addr,
+	input  [31:0] wide_wdata,
+	input  [ 3:0] wide_wstrb,
+	output [31:0] wide_rdata,
+	output        wide_ready,
+	output        wide_mem_valid,
+	output [31:0] wide_mem_addr,
+	output [63:0] wide_mem_wdata,
+	output [ 7:0] wide_mem_wstrb,
+	input  [63:0] wide_mem_rdata,
+	input         wide_mem_ready,
+
+	// smz_bootload (SMZ_MODE_BOOT)
+	output        boot_done,
+	output        ram_we,
+	output [21:0] ram_addr,
+	output [31:0] ram_wdata,
+	output        flash_valid,
+	input         flash_ready,
+	output [23:0] flash_addr,
+	input  [31:0] flash_rdata
+);
+	smz_layer layer (
+		.clk           (clk        ),
+		.resetn        (resetn     ),
+		.cpu_mem_valid (1'b1       ),
+		.cpu_mem_addr  (addr       ),
+		.cpu_mem_wdata (wdata      ),
+		.cpu_mem_wstrb (4'b1111    ),
+		.mem_wdata     (layer_wdata),
+		.mem_rdata     (rdata      ),
+		.smz_base      (smz_base   ),
+		.smz_size      (smz_size   ),
+		.smz_enable    (smz_enable ),
+		.cpu_mem_rdata (layer_rdata)
+	);
+
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000)
+	) smz (
+		.clk           (clk        ),
+		.resetn        (resetn     ),
+		.cpu_mem_valid (1'b1       ),
+		.cpu_mem_addr  (addr       ),
+		.cpu_mem_wdata (wdata      ),
+		.cpu_mem_wstrb (4'b1111    ),
+		.cpu_mem_rdata (smz_rdata  ),
+		.cpu_mem_ready (           ),
+		.mem_valid     (           ),
+		.mem_addr      (           ),
+		.mem_wdata     (smz_wdata  ),
+		.mem_wstrb     (           ),
+		.mem_rdata     (rdata      ),
+		.mem_ready     (1'b1       ),
+		.smz_key_0     (smz_key_0  ),
+		.smz_key_1     (smz_key_1  ),
+		.smz_key_2     (smz_key_2  ),
+		.smz_key_3     (smz_key_3  )
+	);
+
+	// a write of zero, so that the memory side sees the keystream
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000),
+		.CIPHER(1),
+		.CIPHER_ROUNDS(6),
+		.CIPHER_CLK2X(1)
+	) arx (
+		.clk           (clk        ),
+		.resetn        (resetn     ),
+		.clk2x         (clk2x      ),
+		.cpu_mem_valid (arx_valid  ),
+		.cpu_mem_addr  (arx_addr   ),
+		.cpu_mem_wdata (32'h 0     ),
+		.cpu_mem_wstrb (4'b1111    ),
+		.cpu_mem_rdata (           ),
+		.cpu_mem_ready (arx_ready  ),
+		.mem_valid     (           ),
+		.mem_addr      (           ),
+		.mem_wdata     (arx_wdata  ),
+		.mem_wstrb     (           ),
+		.mem_rdata     (32'h 0     ),
+		.mem_ready     (1'b1       ),
+		.smz_key_0     (smz_key_0  ),
+		.smz_key_1     (smz_key_1  ),
+		.smz_key_2     (smz_key_2  ),
+		.smz_key_3     (smz_key_3  )
+	);
+
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000),
+		.CIPHER(2),
+		.CIPHER_LINE_WORDS(8)
+	) trivium (
+		.clk           (clk        ),
+		.resetn        (resetn     ),
+		.clk2x         (1'b0       ),
+		.cpu_mem_valid (triv_valid ),
+		.cpu_mem_addr  (triv_addr  ),
+		.cpu_mem_wdata (32'h 0     ),
+		.cpu_mem_wstrb (4'b1111    ),
+		.cpu_mem_rdata (           ),
+		.cpu_mem_ready (triv_ready ),
+		.mem_valid     (           ),
+		.mem_addr      (           ),
+		.mem_wdata     (triv_wdata ),
+		.mem_wstrb     (           ),
+		.mem_rdata     (32'h 0     ),
+		.mem_ready     (1'b1       ),
+		.smz_key_0     (smz_key_0  ),
+		.smz_key_1     (smz_key_1  ),
+		.smz_key_2     (smz_key_2  ),
+		.smz_key_3     (smz_key_3  )
+	);
+
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000),
+		.CIPHER(1),
+		.CIPHER_ROUNDS(4),
+		.ENABLE_ECC(1)
+	) ecc (
+		.clk           (clk           ),
+		.resetn        (resetn        ),
+		.clk2x         (1'b0          ),
+		.cpu_mem_valid (ecc_valid     ),
+		.cpu_mem_addr  (ecc_addr      ),
+		.cpu_mem_wdata (ecc_wdata     ),
+		.cpu_mem_wstrb (ecc_wstrb     ),
+		.cpu_mem_rdata (ecc_rdata     ),
+		.cpu_mem_ready (ecc_ready     ),
+		.mem_valid     (ecc_mem_valid ),
+		.mem_addr      (ecc_mem_addr  ),
+		.mem_wdata     (ecc_mem_wdata ),
+		.mem_wstrb     (ecc_mem_wstrb ),
+		.mem_rdata     (ecc_mem_rdata ),
+		.mem_ready     (ecc_mem_ready ),
+		.mem_ecc_wdata (ecc_mem_wcheck),
+		.mem_ecc_rdata (ecc_mem_rcheck),
+		.ecc_event     (ecc_event     ),
+		.smz_key_0     (smz_key_0     ),
+		.smz_key_1     (smz_key_1     ),
+		.smz_key_2     (smz_key_2     ),
+		.smz_key_3     (smz_key_3     )
+	);
+
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000),
+		.CIPHER(2),
+		.CIPHER_LINE_WORDS(8),
+		.MEM_WIDTH(64)
+	) wide (
+		.clk           (clk           ),
+		.resetn        (resetn        ),
+		.clk2x         (1'b0          ),
+		.cpu_mem_valid (wide_valid    ),
+		.cpu_mem_addr  (wide_addr     ),
+		.cpu_mem_wdata (wide_wdata    ),
+		.cpu_mem_wstrb (wide_wstrb    ),
+		.cpu_mem_rdata (wide_rdata    ),
+		.cpu_mem_ready (wide_ready    ),
+		.mem_valid     (wide_mem_valid),
+		.mem_addr      (wide_mem_addr ),
+		.mem_wdata     (wide_mem_wdata),
+		.mem_wstrb     (wide_mem_wstrb),
+		.mem_rdata     (wide_mem_rdata),
+		.mem_ready     (wide_mem_ready),
+		.smz_key_0     (smz_key_0     ),
+		.smz_key_1     (smz_key_1     ),
+		.smz_key_2     (smz_key_2     ),
+		.smz_key_3     (smz_key_3     )
+	);
+
+	smz_bootload #(
+		.MEM_WORDS(1024)
+	) boot (
+		.clk          (clk        ),
+		.resetn       (resetn     ),
+		.done         (boot_done  ),
+		.ram_we       (ram_we     ),
+		.ram_addr     (ram_addr   ),
+		.ram_wdata    (ram_wdata  ),
+		.flash_valid  (flash_valid),
+		.flash_ready  (flash_ready),
+		.flash_addr   (flash_addr ),
+		.flash_rdata  (flash_rdata),
+		.flash_cfg_we (           ),
+		.flash_cfg_di (           ),
+		.reg_addr     (2'b00      ),
+		.reg_do       (           )
+	);
+endmodule
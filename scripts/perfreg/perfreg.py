@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+#
+# This is free and unencumbered software released into the public domain.
+#
+# Anyone is free to copy, modify, publish, use, compile, sell, or
+# distribute this software, either in source code form or as a compiled
+# binary, for any purpose, commercial or non-commercial, and by any
+# means.
+#
+# Performance regression tracker for the PicoRV32/SMZ testbenches.
+#
+#   perfreg.py run      [--db F] [--bench B ...] [-- plusargs]
+#   perfreg.py baseline [--db F] [--baseline F] [--commit C]
+#   perfreg.py compare  [--db F] [--baseline F] [--commit C]
+#                       [--cycles-tol PCT] [--speed-tol PCT]
+#   perfreg.py show     [--db F]
+#
+# "run" runs the benchmarks and stores their metrics for the current commit
+# (a later run of the same commit replaces its rows). "baseline" copies the
+# metrics of a commit (default: the latest) into the baseline file, and
+# "compare" checks a commit against it. Simulated cycles and CPI may grow by
+# --cycles-tol percent and simulator speed may drop by --speed-tol percent;
+# beyond that compare exits with status 1.
+#
+
+import argparse, csv, json, os, re, subprocess, sys, time
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+
+# name: (working directory, command, pattern of the pass message,
+#        pattern of the simulated cycles, pattern of the CPI)
+BENCHES = {
+    "firmware": ("", ["vvp", "-N", "testbench.vvp"], r"ALL TESTS PASSED",
+            r"TRAP after (\d+) clock cycles", r"CPI: ([\d.]+)"),
+    "firmware_verilator": ("", ["./testbench_verilator"], r"ALL TESTS PASSED",
+            r"TRAP after (\d+) clock cycles", r"CPI: ([\d.]+)"),
+    "dhrystone": ("dhrystone", ["vvp", "-N", "testbench.vvp"], r"DMIPS_Per_MHz",
+            r"User_Time: (\d+) cycles", r"Cycles_Per_Instruction: ([\d.]+)"),
+}
+
+# metric: True if a larger value is a regression
+METRICS = { "cycles": True, "cpi": True, "sim_khz": False }
+
+FIELDS = ["commit", "date", "bench", "metric", "value"]
+
+def git_commit():
+    commit = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT,
+            stdout=subprocess.PIPE, universal_newlines=True).stdout.strip() or "unknown"
+    if subprocess.run(["git", "diff", "--quiet", "HEAD"], cwd=ROOT).returncode:
+        commit += "-dirty"
+    return commit
+
+def read_db(db):
+    if not os.path.exists(db):
+        return []
+    with open(db) as f:
+        return list(csv.DictReader(f))
+
+def write_db(db, rows):
+    with open(db + ".tmp", "w") as f:
+        w = csv.DictWriter(f, FIELDS)
+        w.writeheader()
+        w.writerows(rows)
+    os.replace(db + ".tmp", db)
+
+def commit_metrics(rows, commit):
+    if commit is None:
+        if not rows:
+            sys.exit("perfreg: no results recorded yet")
+        commit = rows[-1]["commit"]
+    metrics = {}
+    for row in rows:
+        if row["commit"] == commit:
+            metrics.setdefault(row["bench"], {})[row["metric"]] = float(row["value"])
+    if not metrics:
+        sys.exit("perfreg: no results for commit %s" % commit)
+    return commit, metrics
+
+def run_bench(name, plusargs):
+    cwd, cmd, passed, cycles_re, cpi_re = BENCHES[name]
+    start = time.time()
+    try:
+        proc = subprocess.run(cmd + plusargs, cwd=os.path.join(ROOT, cwd),
+                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    except OSError as e:
+        sys.exit("perfreg: %s: %s" % (name, e))
+    elapsed = time.time() - start
+    m_cycles, m_cpi = re.search(cycles_re, proc.stdout), re.search(cpi_re, proc.stdout)
+    if proc.returncode or not re.search(passed, proc.stdout) or not m_cycles:
+        sys.stdout.write(proc.stdout)
+        sys.exit("perfreg: %s failed" % name)
+    metrics = { "cycles": int(m_cycles.group(1)), "sim_khz": int(m_cycles.group(1)) / elapsed / 1000 }
+    if m_cpi:
+        metrics["cpi"] = float(m_cpi.group(1))
+    return metrics
+
+def cmd_run(args):
+    commit, date = git_commit(), time.strftime("%Y-%m-%d %H:%M:%S")
+    rows = read_db(args.db)
+    for name in args.bench or sorted(BENCHES):
+        if name not in BENCHES:
+            sys.exit("perfreg: unknown benchmark %s" % name)
+        metrics = run_bench(name, args.plusargs)
+        rows = [r for r in rows if not (r["commit"] == commit and r["bench"] == name)]
+        for metric, value in sorted(metrics.items()):
+            rows.append({ "commit": commit, "date": date, "bench": name, "metric": metric, "value": str(value) if metric == "cycles" else "%.4f" % value })
+        print("%-20s %s" % (name, "  ".join("%s %.10g" % kv for kv in sorted(metrics.items()))))
+        write_db(args.db, rows)
+    print("perfreg: results of %s stored in %s" % (commit, args.db))
+
+def cmd_baseline(args):
+    commit, metrics = commit_metrics(read_db(args.db), args.commit)
+    with open(args.baseline, "w") as f:
+        json.dump({ "commit": commit, "metrics": metrics }, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("perfreg: baseline is now %s" % commit)
+
+def cmd_compare(args):
+    commit, metrics = commit_metrics(read_db(args.db), args.commit)
+    if not os.path.exists(args.baseline):
+        sys.exit("perfreg: no baseline, run 'perfreg.py baseline' first")
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressions = 0
+    print("%s against baseline %s (cycles/cpi +%g%%, sim_khz -%g%%):" % (commit, baseline["commit"],
+            args.cycles_tol, args.speed_tol))
+    for bench in sorted(baseline["metrics"]):
+        for metric, base in sorted(baseline["metrics"][bench].items()):
+            value = metrics.get(bench, {}).get(metric)
+            if value is None:
+                print("  %-20s %-8s %12.10g  %12s" % (bench, metric, base, "missing"))
+                continue
+            delta = 100.0 * (value - base) / base if base else 0.0
+            tol = args.cycles_tol if METRICS[metric] else args.speed_tol
+            bad = delta > tol if METRICS[metric] else -delta > tol
+            regressions += bad
+            print("  %-20s %-8s %12.10g  %12.10g  %+7.2f%%%s" % (bench, metric, base, value, delta,
+                    "  REGRESSION" if bad else ""))
+    if regressions:
+        print("perfreg: %d regression(s)" % regressions)
+        sys.exit(1)
+    print("perfreg: no regressions")
+
+def cmd_show(args):
+    rows = read_db(args.db)
+    commits = []
+    for row in rows:
+        if row["commit"] not in commits:
+            commits.append(row["commit"])
+    keys = sorted(set((r["bench"], r["metric"]) for r in rows))
+    values = { (r["commit"], r["bench"], r["metric"]): float(r["value"]) for r in rows }
+    print("%-32s" % "" + "".join("%14s" % c[:14] for c in commits))
+    for bench, metric in keys:
+        print("%-32s" % ("%s %s" % (bench, metric)) + "".join("%14s" % ("%.10g" % values[(c, bench, metric)]
+                if (c, bench, metric) in values else "-") for c in commits))
+
+parser = argparse.ArgumentParser(description="Performance regression tracker")
+sub = parser.add_subparsers(dest="cmd")
+
+p = sub.add_parser("run")
+p.add_argument("--db", default="perf.csv")
+p.add_argument("--bench", action="append")
+p.add_argument("plusargs", nargs="*")
+p.set_defaults(func=cmd_run)
+
+p = sub.add_parser("baseline")
+p.add_argument("--db", default="perf.csv")
+p.add_argument("--baseline", default="baseline.json")
+p.add_argument("--commit")
+p.set_defaults(func=cmd_baseline)
+
+p = sub.add_parser("compare")
+p.add_argument("--db", default="perf.csv")
+p.add_argument("--baseline", default="baseline.json")
+p.add_argument("--commit")
+p.add_argument("--cycles-tol", type=float, default=0.5)
+p.add_argument("--speed-tol", type=float, default=25.0)
+p.set_defaults(func=cmd_compare)
+
+p = sub.add_parser("show")
+p.add_argument("--db", default="perf.csv")
+p.set_defaults(func=cmd_show)
+
+args = parser.parse_args()
+if not args.cmd:
+    parser.print_help()
+    sys.exit(2)
+args.func(args)
@@ -0,0 +1,59 @@
+`timescale 1 ns / 1 ps
+
+// system with the SMZ cipher (SYSTEM_SMZ), clk and clk2x from one PLL so
+// that they are phase aligned and the paths between them are timed as
+// synchronous (synth_system_smz.sdc)
+
+module system_smz (
+	input            clk,
+	input            resetn,
+	output           trap,
+	output     [7:0] out_byte,
+	output           out_byte_en
+);
+	parameter SMZ_CLK2X = 1;
+
+	wire [4:0] pll_clk;
+	wire locked;
+
+	// 100 MHz in, 100 MHz and 200 MHz out
+	altpll #(
+		.intended_device_family("Cyclone IV E"),
+		.lpm_type              ("altpll"),
+		.operation_mode        ("NORMAL"),
+		.compensate_clock      ("CLK0"),
+		.inclk0_input_frequency(10000),
+		.clk0_multiply_by      (1),
+		.clk0_divide_by        (1),
+		.clk0_duty_cycle       (50),
+		.clk0_phase_shift      ("0"),
+		.clk1_multiply_by      (2),
+		.clk1_divide_by        (1),
+		.clk1_duty_cycle       (50),
+		.clk1_phase_shift      ("0"),
+		.port_inclk0           ("PORT_USED"),
+		.port_clk0             ("PORT_USED"),
+		.port_clk1             ("PORT_USED"),
+		.port_locked           ("PORT_USED"),
+		.width_clock           (5)
+	) pll (
+		.inclk ({1'b0, clk}),
+		.clk   (pll_clk    ),
+		.locked(locked     )
+	);
+
+	reg [1:0] resetn_q = 0;
+	always @(posedge pll_clk[0])
+		resetn_q <= {resetn_q[0], resetn && locked};
+
+	system #(
+		.SMZ_CLK2X(SMZ_CLK2X)
+	) sys (
+		.clk        (pll_clk[0] ),
+		.clk2x      (pll_clk[1] ),
+		.resetn     (resetn_q[1]),
+		.trap       (trap       ),
+		.out_byte   (out_byte   ),
+		.out_byte_en(out_byte_en)
+	);
+endmodule
@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+#
+# This is free and unencumbered software released into the public domain.
+#
+# Anyone is free to copy, modify, publish, use, compile, sell, or
+# distribute this software, either in source code form or as a compiled
+# binary, for any purpose, commercial or non-commercial, and by any
+# means.
+#
+# SimPoint-style sampled simulation for the PicoRV32 testbenches.
+#
+#   simpoint.py full    --vvp X --cwd D --work W [--interval N] [-- plusargs]
+#   simpoint.py bbv     --work W
+#   simpoint.py cluster --work W [--maxk K] [--seed S]
+#   simpoint.py sample  --vvp X --cwd D --work W [--warmup] [-- plusargs]
+#   simpoint.py report  --work W [--name NAME]
+#
+# "full" runs the benchmark once with +trace, writing interval boundaries and
+# a checkpoint per interval. "bbv" builds a basic block vector per interval
+# from the trace stream, "cluster" picks one representative interval per
+# phase, "sample" simulates only those from their checkpoints (optionally with
+# different plusargs, e.g. for an SMZ variant) and "report" reconstructs the
+# CPI from the weighted samples and compares it against the full run.
+#
+
+import argparse, math, os, random, re, subprocess, sys, time
+
+def read_intervals(work):
+    intervals = []
+    end = None
+    with open(os.path.join(work, "intervals.txt")) as f:
+        for line in f:
+            fields = line.split()
+            if fields[0] == "end":
+                end = tuple(int(x) for x in fields[1:4])
+            else:
+                intervals.append(tuple(int(x) for x in fields[1:4]))
+    if end is None:
+        sys.exit("%s: full run did not reach the trap" % work)
+    # (first instruction, instructions, cycles, first trace record, trace records)
+    result = []
+    for i, (instr, cycle, rec) in enumerate(intervals):
+        nxt = intervals[i+1] if i+1 < len(intervals) else end
+        result.append((instr, nxt[0] - instr, nxt[1] - cycle, rec, nxt[2] - rec))
+    return result, end
+
+def run_vvp(vvp, cwd, args):
+    start = time.time()
+    proc = subprocess.run(["vvp", "-N", os.path.abspath(vvp)] + args, cwd=cwd,
+            stdout=subprocess.PIPE, universal_newlines=True)
+    return proc.stdout, time.time() - start
+
+def cmd_full(args):
+    work = os.path.abspath(args.work)
+    os.makedirs(work, exist_ok=True)
+    out, elapsed = run_vvp(args.vvp, args.cwd, ["+trace", "+simpoint_ckpt=%s/" % work,
+            "+simpoint_interval=%d" % args.interval] + args.plusargs)
+    os.replace(os.path.join(args.cwd, "testbench.trace"), os.path.join(work, "testbench.trace"))
+    with open(os.path.join(work, "full.txt"), "w") as f:
+        print("%d %.3f" % (args.interval, elapsed), file=f)
+    print("full run: %.1f s, %d intervals" % (elapsed, len(read_intervals(work)[0])))
+
+def cmd_bbv(args):
+    intervals, _ = read_intervals(args.work)
+    bounds = [rec for _, _, _, rec, _ in intervals]
+
+    # A trace record with the branch flag carries the target of a taken
+    # branch, i.e. the start of the next basic block. Every record up to the
+    # next taken branch is attributed to that block, so the vector entries
+    # count traced instructions (register writes, memory accesses, branches)
+    # per block.
+    bbvs = [dict() for _ in intervals]
+    block = 0
+    idx = 0
+    with open(os.path.join(args.work, "testbench.trace")) as f:
+        for rec, line in enumerate(f):
+            raw = int(line.replace("x", "0"), 16)
+            while idx+1 < len(bounds) and rec >= bounds[idx+1]:
+                idx += 1
+            if raw & 0x400000000:
+                # SMZ event records (ENABLE_SMZ_TRACE) are not instructions
+                continue
+            if raw & 0x100000000:
+                block = raw & 0xffffffff
+            bbvs[idx][block] = bbvs[idx].get(block, 0) + 1
+
+    with open(os.path.join(args.work, "bbv.txt"), "w") as f:
+        for bbv in bbvs:
+            print(" ".join(":%x:%d" % item for item in sorted(bbv.items())), file=f)
+    print("bbv: %d intervals, %d blocks" % (len(bbvs), len(set().union(*bbvs))))
+
+def read_bbvs(work):
+    bbvs = []
+    with open(os.path.join(work, "bbv.txt")) as f:
+        for line in f:
+            bbv = dict()
+            for item in line.split():
+                _, block, count = item.split(":")
+                bbv[int(block, 16)] = int(count)
+            bbvs.append(bbv)
+    return bbvs
+
+def project(bbvs, dims, seed):
+    # normalize and apply a random linear projection, as SimPoint does
+    rng = random.Random(seed)
+    basis = dict()
+    points = []
+    for bbv in bbvs:
+        total = sum(bbv.values()) or 1
+        point = [0.0] * dims
+        for block, count in bbv.items():
+            if block not in basis:
+                basis[block] = [rng.uniform(-1, 1) for _ in range(dims)]
+            for d in range(dims):
+                point[d] += basis[block][d] * count / total
+        points.append(point)
+    return points
+
+def dist2(a, b):
+    return sum((x - y) ** 2 for x, y in zip(a, b))
+
+def kmeans(points, k, rng, iterations=100):
+    centers = [list(p) for p in rng.sample(points, k)]
+    assign = [0] * len(points)
+    for _ in range(iterations):
+        new_assign = [min(range(k), key=lambda c: dist2(p, centers[c])) for p in points]
+        if new_assign == assign and _ > 0:
+            break
+        assign = new_assign
+        for c in range(k):
+            members = [p for p, a in zip(points, assign) if a == c]
+            if members:
+                centers[c] = [sum(x) / len(members) for x in zip(*members)]
+    distortion = sum(dist2(p, centers[a]) for p, a in zip(points, assign))
+    return assign, centers, distortion
+
+def bic(points, assign, centers):
+    # Pelleg and Moore, X-means, as used by SimPoint to choose k
+    R = len(points)
+    M = len(points[0])
+    K = len(centers)
+    if R <= K:
+        return float("-inf")
+    variance = sum(dist2(p, centers[a]) for p, a in zip(points, assign)) / (M * (R - K))
+    variance = max(variance, 1e-12)
+    loglik = 0
+    for c in range(K):
+        Rc = assign.count(c)
+        if Rc == 0:
+            continue
+        loglik += (Rc * math.log(Rc) - Rc * math.log(R) - Rc * M / 2 * math.log(2 * math.pi * variance)
+                - (Rc - K) / 2)
+    params = (K - 1) + M * K + 1
+    return loglik - params / 2 * math.log(R)
+
+def cmd_cluster(args):
+    intervals, _ = read_intervals(args.work)
+    points = project(read_bbvs(args.work), args.dims, args.seed)
+    rng = random.Random(args.seed)
+
+    results = []
+    for k in range(1, min(args.maxk, len(points)) + 1):
+        best = min((kmeans(points, k, rng) for _ in range(args.inits)), key=lambda r: r[2])
+        results.append((k, best, bic(points, best[0], best[1])))
+
+    # smallest k that reaches 90% of the BIC range
+    valid = [r for r in results if r[2] != float("-inf")]
+    if valid:
+        lo = min(r[2] for r in valid)
+        hi = max(r[2] for r in valid)
+        k, (assign, centers, _), _ = next(r for r in valid if r[2] >= lo + 0.9 * (hi - lo))
+    else:
+        k, (assign, centers, _), _ = results[0]
+
+    total = sum(n for _, n, _, _, _ in intervals)
+    with open(os.path.join(args.work, "simpoints.txt"), "w") as f:
+        for c in range(k):
+            members = [i for i, a in enumerate(assign) if a == c]
+            if not members:
+                continue
+            rep = min(members, key=lambda i: dist2(points[i], centers[c]))
+            weight = sum(intervals[i][1] for i in members) / total
+            print("%d %.6f %d" % (rep, weight, len(members)), file=f)
+    print("cluster: k=%d of %d intervals" % (k, len(points)))
+
+def read_simpoints(work):
+    with open(os.path.join(work, "simpoints.txt")) as f:
+        return [(int(a), float(b), int(c)) for a, b, c in (line.split() for line in f)]
+
+def cmd_sample(args):
+    intervals, _ = read_intervals(args.work)
+    work = os.path.abspath(args.work)
+    pattern = re.compile(r"SIMPOINT SAMPLE \S+ instr=(\d+) cycles=(\d+)")
+    elapsed = 0
+    with open(os.path.join(work, args.output), "w") as f:
+        for idx, weight, _ in read_simpoints(work):
+            start = idx - 1 if args.warmup and idx > 0 else idx
+            warmup = intervals[idx][0] - intervals[start][0]
+            out, t = run_vvp(args.vvp, args.cwd, ["+simpoint_restore=%s/%04d" % (work, start),
+                    "+simpoint_length=%d" % intervals[idx][1], "+simpoint_warmup=%d" % warmup] + args.plusargs)
+            elapsed += t
+            match = pattern.search(out)
+            if not match:
+                sys.exit("interval %d: no SIMPOINT SAMPLE in output:\n%s" % (idx, out))
+            print("%d %.6f %s %s" % (idx, weight, match.group(1), match.group(2)), file=f)
+    with open(os.path.join(work, args.output), "a") as f:
+        print("time %.3f" % elapsed, file=f)
+    print("sample: %.1f s" % elapsed)
+
+def cmd_report(args):
+    intervals, end = read_intervals(args.work)
+    full_cpi = end[1] / end[0]
+    with open(os.path.join(args.work, "full.txt")) as f:
+        full_time = float(f.read().split()[1])
+
+    samples = []
+    sample_time = 0
+    with open(os.path.join(args.work, args.samples)) as f:
+        for line in f:
+            fields = line.split()
+            if fields[0] == "time":
+                sample_time = float(fields[1])
+            else:
+                samples.append((int(fields[0]), float(fields[1]), int(fields[2]), int(fields[3])))
+
+    weights = sum(w for _, w, _, _ in samples)
+    est_cpi = sum(w * c / n for _, w, n, c in samples if n) / weights
+    # the same weighting over the cycle counts of the full run separates the
+    # clustering error from the checkpoint restore error
+    oracle_cpi = sum(w * intervals[i][2] / intervals[i][1] for i, w, _, _ in samples) / weights
+    sim_instr = sum(n for _, _, n, _ in samples)
+
+    name = args.name or os.path.basename(os.path.normpath(args.work))
+    print("%-12s intervals %3d  simpoints %2d  simulated %5.1f%%  time %6.1fs / %6.1fs" % (name,
+            len(intervals), len(samples), 100 * sim_instr / end[0], sample_time, full_time))
+    print("%-12s full CPI %.4f  oracle CPI %.4f  sampled CPI %.4f  error %+.2f%%" % ("",
+            full_cpi, oracle_cpi, est_cpi, 100 * (est_cpi - full_cpi) / full_cpi))
+
+parser = argparse.ArgumentParser(description="SimPoint-style sampled simulation")
+sub = parser.add_subparsers(dest="cmd")
+sub.required = True
+
+p = sub.add_parser("full")
+p.add_argument("--vvp", required=True)
+p.add_argument("--cwd", default=".")
+p.add_argument("--work", required=True)
+p.add_argument("--interval", type=int, default=10000)
+p.add_argument("plusargs", nargs="*")
+p.set_defaults(func=cmd_full)
+
+p = sub.add_parser("bbv")
+p.add_argument("--work", required=True)
+p.set_defaults(func=cmd_bbv)
+
+p = sub.add_parser("cluster")
+p.add_argument("--work", required=True)
+p.add_argument("--maxk", type=int, default=10)
+p.add_argument("--dims", type=int, default=15)
+p.add_argument("--inits", type=int, default=5)
+p.add_argument("--seed", type=int, default=1)
+p.set_defaults(func=cmd_cluster)
+
+p = sub.add_parser("sample")
+p.add_argument("--vvp", required=True)
+p.add_argument("--cwd", default=".")
+p.add_argument("--work", required=True)
+p.add_argument("--warmup", action="store_true")
+p.add_argument("--output", default="samples.txt")
+p.add_argument("plusargs", nargs="*")
+p.set_defaults(func=cmd_sample)
+
+p = sub.add_parser("report")
+p.add_argument("--work", required=True)
+p.add_argument("--samples", default="samples.txt")
+p.add_argument("--name")
+p.set_defaults(func=cmd_report)
+
+args = parser.parse_args()
+args.func(args)
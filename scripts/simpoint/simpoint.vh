@@ -0,0 +1,208 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// SimPoint interval checkpoints for the PicoRV32 testbenches.
+//
+// Included into a testbench module when compiled with -DSIMPOINT. The
+// including module must define:
+//
+//   SIMPOINT_CORE        hierarchical path to the picorv32 core
+//   SIMPOINT_MEM         the testbench memory array
+//   SIMPOINT_MEM_WORD(a) an lvalue for the 32 bit memory word at address a
+//   SIMPOINT_RESET_ADDR  PROGADDR_RESET of the core
+//   SIMPOINT_IRQ_PHASE   (optional) free running counter that drives the
+//                        testbench interrupts
+//
+// and provide trace_valid and trap. Plusargs:
+//
+//   +simpoint_ckpt=<prefix> +simpoint_interval=<n>
+//       Full run. Writes <prefix>intervals.txt and, at the first instruction
+//       and then at the first instruction boundary outside an IRQ handler
+//       after every <n> instructions, a checkpoint <prefix>NNNN.mem (memory)
+//       and <prefix>NNNN.state.
+//
+//   +simpoint_restore=<prefix>NNNN +simpoint_length=<n> [+simpoint_warmup=<w>]
+//       Sampled run. Restores the checkpoint, runs <w> instructions to warm
+//       up, measures the next <n> instructions, prints a SIMPOINT SAMPLE line
+//       and finishes.
+//
+// Architectural state is restored by placing a "jal zero, <pc>" at the reset
+// vector and writing the register file, IRQ state, counters and SMZ CSRs as
+// soon as the target instruction is fetched. PicoRV32 has no caches or
+// predictors, so no microarchitectural state is lost beyond the memory model.
+
+`define SIMPOINT_STATE_REGS 16
+
+reg [1023:0] simpoint_prefix;
+reg [1023:0] simpoint_file;
+integer simpoint_interval = 0;
+integer simpoint_length = 0;
+integer simpoint_warmup = 0;
+integer simpoint_index = 0;
+integer simpoint_fd;
+integer simpoint_i;
+reg simpoint_capture = 0;
+reg simpoint_restore = 0;
+reg simpoint_restored = 0;
+reg simpoint_measuring = 0;
+
+reg [31:0] simpoint_state [0:`SIMPOINT_STATE_REGS+36-1];
+reg [31:0] simpoint_reset_word;
+
+reg [63:0] simpoint_cycles = 0;
+reg [63:0] simpoint_trace_records = 0;
+reg [63:0] simpoint_last_instr = 0;
+reg [63:0] simpoint_next_instr = 0;
+reg [63:0] simpoint_begin_instr;
+reg [63:0] simpoint_begin_cycles;
+reg [63:0] simpoint_end_instr;
+
+function [31:0] simpoint_jal;
+	input [31:0] from;
+	input [31:0] to;
+	reg [31:0] imm;
+	begin
+		imm = to - from;
+		simpoint_jal = {imm[20], imm[10:1], imm[11], imm[19:12], 5'd 0, 7'b 1101111};
+	end
+endfunction
+
+initial begin
+	if ($value$plusargs("simpoint_ckpt=%s", simpoint_prefix)) begin
+		if (!$value$plusargs("simpoint_interval=%d", simpoint_interval))
+			simpoint_interval = 10000;
+		simpoint_capture = 1;
+		simpoint_next_instr = 0;
+		$sformat(simpoint_file, "%0sintervals.txt", simpoint_prefix);
+		simpoint_fd = $fopen(simpoint_file, "w");
+	end
+	if ($value$plusargs("simpoint_restore=%s", simpoint_prefix)) begin
+		if (!$value$plusargs("simpoint_length=%d", simpoint_length))
+			simpoint_length = 10000;
+		if (!$value$plusargs("simpoint_warmup=%d", simpoint_warmup))
+			simpoint_warmup = 0;
+		simpoint_restore = 1;
+		// let the testbench load its firmware image first
+		#1;
+		$sformat(simpoint_file, "%0s.mem", simpoint_prefix);
+		$readmemh(simpoint_file, `SIMPOINT_MEM);
+		$sformat(simpoint_file, "%0s.state", simpoint_prefix);
+		$readmemh(simpoint_file, simpoint_state);
+		simpoint_reset_word = `SIMPOINT_MEM_WORD(`SIMPOINT_RESET_ADDR);
+		// checkpoint 0 is taken at the reset vector and needs no trampoline
+		if (simpoint_state[0] != `SIMPOINT_RESET_ADDR)
+			`SIMPOINT_MEM_WORD(`SIMPOINT_RESET_ADDR) = simpoint_jal(`SIMPOINT_RESET_ADDR, simpoint_state[0]);
+	end
+end
+
+always @(posedge clk) begin
+	simpoint_cycles <= simpoint_cycles + 1;
+	if (trace_valid)
+		simpoint_trace_records <= simpoint_trace_records + 1;
+end
+
+task simpoint_write_checkpoint;
+	integer fd, i;
+	begin
+		$sformat(simpoint_file, "%0s%04d.mem", simpoint_prefix, simpoint_index);
+		$writememh(simpoint_file, `SIMPOINT_MEM);
+		$sformat(simpoint_file, "%0s%04d.state", simpoint_prefix, simpoint_index);
+		fd = $fopen(simpoint_file, "w");
+		$fwrite(fd, "%08x // pc\n", `SIMPOINT_CORE.reg_pc);
+		$fwrite(fd, "%08x // instret\n", simpoint_begin_instr[31:0]);
+		$fwrite(fd, "%08x // cycle\n", `SIMPOINT_CORE.count_cycle[31:0]);
+		$fwrite(fd, "%08x // irq_mask\n", `SIMPOINT_CORE.irq_mask);
+		$fwrite(fd, "%08x // irq_pending\n", `SIMPOINT_CORE.irq_pending);
+		$fwrite(fd, "%08x // timer\n", `SIMPOINT_CORE.timer);
+		$fwrite(fd, "%08x // smz_base\n", `SIMPOINT_CORE.smz_base);
+		$fwrite(fd, "%08x // smz_size\n", `SIMPOINT_CORE.smz_size);
+		$fwrite(fd, "%08x // smz_enable\n", `SIMPOINT_CORE.smz_enable);
+`ifdef SIMPOINT_IRQ_PHASE
+		$fwrite(fd, "%08x // irq phase\n", `SIMPOINT_IRQ_PHASE);
+`else
+		$fwrite(fd, "00000000 // irq phase\n");
+`endif
+		for (i = 10; i < `SIMPOINT_STATE_REGS; i = i + 1)
+			$fwrite(fd, "00000000\n");
+		// x0..x31 and, with ENABLE_IRQ_QREGS, q0..q3
+		for (i = 0; i < 36; i = i + 1)
+			$fwrite(fd, "%08x // r%0d\n", `SIMPOINT_CORE.cpuregs[i], i);
+		$fclose(fd);
+	end
+endtask
+
+// An instruction was launched in the last cycle if count_instr moved. At
+// the falling edge reg_pc holds its address and the register file holds the
+// results of all earlier instructions.
+always @(negedge clk) begin
+	if (`SIMPOINT_CORE.count_instr != simpoint_last_instr) begin
+		simpoint_last_instr = `SIMPOINT_CORE.count_instr;
+
+		if (simpoint_capture && simpoint_last_instr - 1 >= simpoint_next_instr && !`SIMPOINT_CORE.irq_active) begin
+			simpoint_begin_instr = simpoint_last_instr - 1;
+			simpoint_write_checkpoint;
+			$fwrite(simpoint_fd, "%0d %0d %0d %0d %08x\n", simpoint_index, simpoint_begin_instr,
+					`SIMPOINT_CORE.count_cycle, simpoint_trace_records, `SIMPOINT_CORE.reg_pc);
+			$fflush(simpoint_fd);
+			simpoint_index = simpoint_index + 1;
+			simpoint_next_instr = simpoint_begin_instr + simpoint_interval;
+		end
+
+		if (simpoint_restore && !simpoint_restored && `SIMPOINT_CORE.reg_pc == simpoint_state[0]) begin
+			for (simpoint_i = 1; simpoint_i < 36; simpoint_i = simpoint_i + 1)
+				`SIMPOINT_CORE.cpuregs[simpoint_i] = simpoint_state[`SIMPOINT_STATE_REGS + simpoint_i];
+			`SIMPOINT_CORE.count_instr = simpoint_state[1] + 1;
+			`SIMPOINT_CORE.count_cycle = simpoint_state[2];
+			`SIMPOINT_CORE.irq_mask = simpoint_state[3];
+			`SIMPOINT_CORE.irq_pending = simpoint_state[4];
+			`SIMPOINT_CORE.timer = simpoint_state[5];
+			`SIMPOINT_CORE.smz_base = simpoint_state[6];
+			`SIMPOINT_CORE.smz_size = simpoint_state[7];
+			`SIMPOINT_CORE.smz_enable = simpoint_state[8];
+`ifdef SIMPOINT_IRQ_PHASE
+			`SIMPOINT_IRQ_PHASE = simpoint_state[9];
+`endif
+			`SIMPOINT_MEM_WORD(`SIMPOINT_RESET_ADDR) = simpoint_reset_word;
+			simpoint_last_instr = simpoint_state[1] + 1;
+			simpoint_begin_instr = simpoint_state[1] + simpoint_warmup;
+			simpoint_end_instr = simpoint_begin_instr + simpoint_length;
+			simpoint_restored = 1;
+			simpoint_measuring = simpoint_warmup == 0;
+			simpoint_begin_cycles = simpoint_cycles;
+		end else
+		if (simpoint_restored && !simpoint_measuring && simpoint_last_instr - 1 >= simpoint_begin_instr) begin
+			simpoint_begin_instr = simpoint_last_instr - 1;
+			simpoint_end_instr = simpoint_begin_instr + simpoint_length;
+			simpoint_begin_cycles = simpoint_cycles;
+			simpoint_measuring = 1;
+		end else
+		if (simpoint_measuring && simpoint_last_instr - 1 >= simpoint_end_instr) begin
+			$display("SIMPOINT SAMPLE %0s instr=%0d cycles=%0d", simpoint_prefix,
+					simpoint_last_instr - 1 - simpoint_begin_instr, simpoint_cycles - simpoint_begin_cycles);
+			$finish;
+		end
+	end
+end
+
+// the full run ends at the trap, a sampled run may reach it before the
+// interval is complete (the last interval of a benchmark)
+always @(posedge clk) begin
+	if (trap && simpoint_capture) begin
+		$fwrite(simpoint_fd, "end %0d %0d %0d\n", `SIMPOINT_CORE.count_instr,
+				`SIMPOINT_CORE.count_cycle, simpoint_trace_records);
+		$fclose(simpoint_fd);
+		simpoint_capture = 0;
+	end
+	if (trap && simpoint_restore) begin
+		if (simpoint_measuring)
+			$display("SIMPOINT SAMPLE %0s instr=%0d cycles=%0d", simpoint_prefix,
+					`SIMPOINT_CORE.count_instr - simpoint_begin_instr, simpoint_cycles - simpoint_begin_cycles);
+		else
+			$display("SIMPOINT SAMPLE %0s instr=0 cycles=0", simpoint_prefix);
+		$finish;
+	end
+end
@@ -0,0 +1,39 @@
+#!/bin/bash
+
+set -ex
+
+# check <name> <steps> <chparam settings>: one picorv32_smz configuration,
+# the engine on clk2x runs with a global clock (four steps per clk cycle)
+check() {
+	name=$1
+	steps=$2
+	shift 2
+
+	multiclock=
+	case "$*" in
+		*"CIPHER_CLK2X 1"*) multiclock=clk2fflogic ;;
+	esac
+
+	yosys -ql smzlatency_$name.yslog \
+		-p 'read_verilog ../../picorv32.v' \
+		-p 'read_verilog -formal smzlatency.v' \
+		-p "chparam $* testbench" \
+		-p 'prep -top testbench -nordff' \
+		${multiclock:+-p $multiclock} \
+		-p "write_smt2 -wires smzlatency_$name.smt2"
+
+	yosys-smtbmc -t $steps -s boolector --dump-vcd output.vcd --dump-smtc output.smtc smzlatency_$name.smt2
+	yosys-smtbmc -t $steps -i -s boolector --dump-vcd output.vcd --dump-smtc output.smtc smzlatency_$name.smt2
+}
+
+check xor                  30 -set CIPHER 0
+check arx                  30 -set CIPHER 1
+check arx_clk2x           100 -set CIPHER 1 -set CIPHER_CLK2X 1
+check arx_64               40 -set CIPHER 1 -set MEM_WIDTH 64
+check arx_clk2x_64        120 -set CIPHER 1 -set CIPHER_CLK2X 1 -set MEM_WIDTH 64
+check trivium             100 -set CIPHER 2
+check trivium_clk2x       240 -set CIPHER 2 -set CIPHER_CLK2X 1
+check trivium_64          180 -set CIPHER 2 -set MEM_WIDTH 64
+check arx_ecc              40 -set CIPHER 1 -set ENABLE_ECC 1
+check arx_clk2x_ecc       120 -set CIPHER 1 -set CIPHER_CLK2X 1 -set ENABLE_ECC 1
+check trivium_ecc         100 -set CIPHER 2 -set ENABLE_ECC 1
@@ -0,0 +1,185 @@
+// Bounded latency of the SMZ layer (picorv32_smz) between the core and memory.
+//
+// The memory behind the SMZ may stall each request for up to MEM_LATENCY
+// cycles. Under that assumption every CPU request must be answered within
+// MEM_LATENCY + SMZ_LATENCY cycles, and a stalled request must be held on the
+// memory side until it is accepted, so backpressure can never make the SMZ
+// drop or lose a transfer. smzlatency.sh runs it for each cipher, with the
+// engine on clk2x, with the 64 bit memory bus and with ENABLE_ECC (chparam).
+//
+// SMZ_LATENCY is 0 for the key XOR. The iterative ciphers take the clk
+// cycle that starts the engine and ENGINE_CYCLES more for the keystream,
+// which a store waits for before it goes to memory. On the 64 bit bus a
+// request may also have to wait for the engine to finish decrypting the
+// upper word of the last doubleword read. An engine step is a round of the
+// ARX cipher, or for Trivium the load, the initialization rounds and one
+// round per word up to the last word of a line; two steps fit in a clk
+// cycle on clk2x. With ENABLE_ECC a byte or halfword store to the secure
+// region reads the word before it writes it, a second memory transfer of
+// up to MEM_LATENCY cycles.
+
+module testbench #(
+	parameter integer CIPHER = 0,
+	parameter integer CIPHER_ROUNDS = 4,
+	parameter integer CIPHER_LINE_WORDS = 2,
+	parameter [ 0:0] CIPHER_CLK2X = 0,
+	parameter integer MEM_WIDTH = 32,
+	parameter [ 0:0] ENABLE_ECC = 0
+) (
+	input         clk,
+	input         clk2x,
+
+	input         cpu_mem_valid,
+	input  [31:0] cpu_mem_addr,
+	input  [31:0] cpu_mem_wdata,
+	input  [ 3:0] cpu_mem_wstrb,
+
+	input  [MEM_WIDTH-1:0] mem_rdata,
+	input  [ 6:0] mem_ecc_rdata,
+	input         mem_ready,
+
+	input  [31:0] smz_key_0,
+	input  [31:0] smz_key_1,
+	input  [31:0] smz_key_2,
+	input  [31:0] smz_key_3
+);
+	localparam integer MEM_LATENCY = 4;
+	localparam integer ENGINE_STEPS = CIPHER == 2 ? 1 + 1152 / 32 + CIPHER_LINE_WORDS : CIPHER_ROUNDS;
+	localparam integer ENGINE_CYCLES = CIPHER_CLK2X ? ENGINE_STEPS / 2 : ENGINE_STEPS;
+	localparam integer SMZ_LATENCY = (CIPHER == 0 ? 0 : 1 + ENGINE_CYCLES * (MEM_WIDTH == 64 ? 2 : 1)) +
+			(ENABLE_ECC ? MEM_LATENCY : 0);
+	localparam integer BOUND = MEM_LATENCY + SMZ_LATENCY;
+
+	reg resetn = 0;
+
+	always @(posedge clk)
+		resetn <= 1;
+
+	wire        cpu_mem_ready;
+	wire [31:0] cpu_mem_rdata;
+
+	wire        mem_valid;
+	wire [31:0] mem_addr;
+	wire [MEM_WIDTH-1:0] mem_wdata;
+	wire [MEM_WIDTH/8-1:0] mem_wstrb;
+
+	picorv32_smz #(
+		.SECURE_REGION_BASE(32'h 0001_0000),
+		.SECURE_REGION_SIZE(32'h 0001_0000),
+		.ENABLE_SMZ(1),
+		.CIPHER(CIPHER),
+		.CIPHER_ROUNDS(CIPHER_ROUNDS),
+		.CIPHER_LINE_WORDS(CIPHER_LINE_WORDS),
+		.CIPHER_CLK2X(CIPHER_CLK2X),
+		.MEM_WIDTH(MEM_WIDTH),
+		.ENABLE_ECC(ENABLE_ECC)
+	) uut (
+		.clk           (clk          ),
+		.resetn        (resetn       ),
+		.clk2x         (clk2x        ),
+		.cpu_mem_valid (cpu_mem_valid),
+		.cpu_mem_addr  (cpu_mem_addr ),
+		.cpu_mem_wdata (cpu_mem_wdata),
+		.cpu_mem_wstrb (cpu_mem_wstrb),
+		.cpu_mem_rdata (cpu_mem_rdata),
+		.cpu_mem_ready (cpu_mem_ready),
+		.mem_valid     (mem_valid    ),
+		.mem_addr      (mem_addr     ),
+		.mem_wdata     (mem_wdata    ),
+		.mem_wstrb     (mem_wstrb    ),
+		.mem_rdata     (mem_rdata    ),
+		.mem_ready     (mem_ready    ),
+		.mem_ecc_wdata (             ),
+		.mem_ecc_rdata (mem_ecc_rdata),
+		.ecc_event     (             ),
+		.smz_key_0     (smz_key_0    ),
+		.smz_key_1     (smz_key_1    ),
+		.smz_key_2     (smz_key_2    ),
+		.smz_key_3     (smz_key_3    )
+	);
+
+	// CIPHER_CLK2X: clk2x toggles in every step (clk2fflogic), clk rises
+	// with every second rising edge of clk2x, and the inputs only change
+	// with the rising edge of clk
+	generate if (CIPHER_CLK2X) begin : clocks
+		reg [1:0] phase = 0;
+
+		always @($global_clock) begin
+			phase <= phase + 1;
+			assume (clk2x == phase[0]);
+			assume (clk == (phase[0] ^ phase[1]));
+			if (phase != 1) begin
+				assume ($stable(cpu_mem_valid));
+				assume ($stable(cpu_mem_addr));
+				assume ($stable(cpu_mem_wdata));
+				assume ($stable(cpu_mem_wstrb));
+				assume ($stable(mem_rdata));
+				assume ($stable(mem_ecc_rdata));
+				assume ($stable(mem_ready));
+				assume ($stable(smz_key_0));
+				assume ($stable(smz_key_1));
+				assume ($stable(smz_key_2));
+				assume ($stable(smz_key_3));
+			end
+		end
+	end endgenerate
+
+	reg [7:0] cpu_wait = 0;
+	reg [7:0] mem_wait = 0;
+
+	always @(posedge clk) begin
+		cpu_wait <= resetn && cpu_mem_valid && !cpu_mem_ready ? cpu_wait + 1 : 0;
+		mem_wait <= resetn && mem_valid && !mem_ready ? mem_wait + 1 : 0;
+	end
+
+	always @(posedge clk) begin
+		// the core holds a request stable until it is answered (native picorv32 interface)
+		if (!resetn) begin
+			assume (!cpu_mem_valid);
+		end else if ($past(resetn) && $past(cpu_mem_valid && !cpu_mem_ready)) begin
+			assume (cpu_mem_valid);
+			assume ($stable(cpu_mem_addr));
+			assume ($stable(cpu_mem_wdata));
+			assume ($stable(cpu_mem_wstrb));
+		end
+
+		// the key only changes between transfers
+		if (resetn && $past(resetn) && $past(cpu_mem_valid && !cpu_mem_ready)) begin
+			assume ($stable(smz_key_0));
+			assume ($stable(smz_key_1));
+			assume ($stable(smz_key_2));
+			assume ($stable(smz_key_3));
+		end
+
+		// memory backpressure: ready only for a request, and at the latest
+		// in the MEM_LATENCY-th cycle of the request
+		if (!mem_valid)
+			assume (!mem_ready);
+		if (mem_valid && mem_wait == MEM_LATENCY-1)
+			assume (mem_ready);
+	end
+
+	always @(posedge clk) begin
+		if (resetn) begin
+			// every request is answered within the bound
+			assert (cpu_wait < BOUND);
+			assert (mem_wait < MEM_LATENCY);
+
+			// no spurious answers
+			if (cpu_mem_ready)
+				assert (cpu_mem_valid);
+
+			// a stalled memory request is neither dropped nor changed
+			if ($past(resetn) && $past(mem_valid && !mem_ready)) begin
+				assert (mem_valid);
+				assert ($stable(mem_addr));
+				assert ($stable(mem_wdata));
+				assert ($stable(mem_wstrb));
+			end
+
+			// a CPU request is forwarded to memory while it waits
+			if (cpu_mem_valid && !cpu_mem_ready && cpu_wait >= SMZ_LATENCY)
+				assert (mem_valid);
+		end
+	end
+endmodule
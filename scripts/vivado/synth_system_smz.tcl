@@ -0,0 +1,18 @@
+
+read_verilog system_smz.v
+read_verilog system.v
+read_verilog ../../picorv32.v
+read_xdc synth_system.xdc
+read_xdc synth_system_smz.xdc
+
+synth_design -part xc7a35t-cpg236-1 -top system_smz -verilog_define SYSTEM_SMZ
+opt_design
+place_design
+route_design
+
+report_utilization
+report_timing
+report_clock_interaction
+
+write_verilog -force synth_system_smz.v
+write_bitstream -force synth_system_smz.bit
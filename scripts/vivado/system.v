@@ -2,24 +2,42 @@
 
 module system (
 	input            clk,
+`ifdef SYSTEM_SMZ
+	input            clk2x,
+`endif
 	input            resetn,
 	output           trap,
 	output reg [7:0] out_byte,
 	output reg       out_byte_en
 );
+`ifdef SYSTEM_SMZ
+	// the look-ahead interface bypasses the SMZ
+	parameter FAST_MEMORY = 0;
+
+	// run the SMZ cipher on clk2x
+	parameter SMZ_CLK2X = 0;
+
+	// SMZ memory bus width, 64 reads and writes a doubleword
+	parameter SMZ_MEM_WIDTH = 32;
+	localparam MEM_WIDTH = SMZ_MEM_WIDTH;
+`else
 	// set this to 0 for better timing but less performance/MHz
 	parameter FAST_MEMORY = 1;
+`endif
 
 	// 4096 32bit words = 16kB memory
 	parameter MEM_SIZE = 4096;
+`ifndef SYSTEM_SMZ
+	localparam MEM_WIDTH = 32;
+`endif
 
 	wire mem_valid;
 	wire mem_instr;
 	reg mem_ready;
 	wire [31:0] mem_addr;
-	wire [31:0] mem_wdata;
-	wire [3:0] mem_wstrb;
-	reg [31:0] mem_rdata;
+	wire [MEM_WIDTH-1:0] mem_wdata;
+	wire [MEM_WIDTH/8-1:0] mem_wstrb;
+	reg [MEM_WIDTH-1:0] mem_rdata;
 
 	wire mem_la_read;
 	wire mem_la_write;
@@ -27,9 +45,33 @@ module system (
 	wire [31:0] mem_la_wdata;
 	wire [3:0] mem_la_wstrb;
 
+`ifdef SYSTEM_SMZ
+	// the upper half of the memory (the stack) is encrypted with the ARX
+	// cipher of picorv32_smz
+	picorv32_with_smz #(
+		.SMZ_REGION_BASE (MEM_SIZE * 2),
+		.SMZ_REGION_SIZE (MEM_SIZE * 2),
+		.SMZ_CIPHER      (1),
+		.SMZ_CIPHER_CLK2X(SMZ_CLK2X),
+		.SMZ_MEM_WIDTH   (SMZ_MEM_WIDTH)
+	) picorv32_core (
+		.clk         (clk         ),
+		.clk2x       (clk2x       ),
+		.resetn      (resetn      ),
+		.pcpi_wr     (1'b0        ),
+		.pcpi_rd     (32'b0       ),
+		.pcpi_wait   (1'b0        ),
+		.pcpi_ready  (1'b0        ),
+		.irq         (32'b0       ),
+		.smz_key_0   (32'h 0f1e2d3c),
+		.smz_key_1   (32'h 4b5a6978),
+		.smz_key_2   (32'h 8796a5b4),
+		.smz_key_3   (32'h c3d2e1f0),
+`else
 	picorv32 picorv32_core (
 		.clk         (clk         ),
 		.resetn      (resetn      ),
+`endif
 		.trap        (trap        ),
 		.mem_valid   (mem_valid   ),
 		.mem_instr   (mem_instr   ),
@@ -48,8 +90,9 @@ module system (
 	reg [31:0] memory [0:MEM_SIZE-1];
 	initial $readmemh("firmware.hex", memory);
 
-	reg [31:0] m_read_data;
+	reg [MEM_WIDTH-1:0] m_read_data;
 	reg m_read_en;
+	integer lane;
 
 	generate if (FAST_MEMORY) begin
 		always @(posedge clk) begin
@@ -73,7 +116,9 @@ module system (
 			m_read_en <= 0;
 			mem_ready <= mem_valid && !mem_ready && m_read_en;
 
-			m_read_data <= memory[mem_addr >> 2];
+			// a MEM_WIDTH/32 word wide port on the 32 bit memory
+			for (lane = 0; lane < MEM_WIDTH/32; lane = lane + 1)
+				m_read_data[32*lane +: 32] <= memory[(mem_addr >> 2) + lane];
 			mem_rdata <= m_read_data;
 
 			out_byte_en <= 0;
@@ -84,10 +129,12 @@ module system (
 					m_read_en <= 1;
 				end
 				mem_valid && !mem_ready && |mem_wstrb && (mem_addr >> 2) < MEM_SIZE: begin
-					if (mem_wstrb[0]) memory[mem_addr >> 2][ 7: 0] <= mem_wdata[ 7: 0];
-					if (mem_wstrb[1]) memory[mem_addr >> 2][15: 8] <= mem_wdata[15: 8];
-					if (mem_wstrb[2]) memory[mem_addr >> 2][23:16] <= mem_wdata[23:16];
-					if (mem_wstrb[3]) memory[mem_addr >> 2][31:24] <= mem_wdata[31:24];
+					for (lane = 0; lane < MEM_WIDTH/32; lane = lane + 1) begin
+						if (mem_wstrb[4*lane+0]) memory[(mem_addr >> 2) + lane][ 7: 0] <= mem_wdata[32*lane+ 0 +: 8];
+						if (mem_wstrb[4*lane+1]) memory[(mem_addr >> 2) + lane][15: 8] <= mem_wdata[32*lane+ 8 +: 8];
+						if (mem_wstrb[4*lane+2]) memory[(mem_addr >> 2) + lane][23:16] <= mem_wdata[32*lane+16 +: 8];
+						if (mem_wstrb[4*lane+3]) memory[(mem_addr >> 2) + lane][31:24] <= mem_wdata[32*lane+24 +: 8];
+					end
 					mem_ready <= 1;
 				end
 				mem_valid && !mem_ready && |mem_wstrb && mem_addr == 32'h1000_0000: begin
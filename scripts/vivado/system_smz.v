@@ -0,0 +1,54 @@
+`timescale 1 ns / 1 ps
+
+// system with the SMZ cipher (SYSTEM_SMZ), clk and clk2x from one MMCM so
+// that they are phase aligned and the paths between them are timed as
+// synchronous (synth_system_smz.xdc)
+
+module system_smz (
+	input            clk,
+	input            resetn,
+	output           trap,
+	output     [7:0] out_byte,
+	output           out_byte_en
+);
+	parameter SMZ_CLK2X = 1;
+
+	wire clk_fb, clk_cpu_unbuf, clk_smz_unbuf;
+	wire clk_cpu, clk_smz, locked;
+
+	// 100 MHz in, VCO at 1 GHz, 100 MHz and 200 MHz out
+	MMCME2_BASE #(
+		.CLKIN1_PERIOD   (10.0),
+		.CLKFBOUT_MULT_F (10.0),
+		.DIVCLK_DIVIDE   (1),
+		.CLKOUT0_DIVIDE_F(10.0),
+		.CLKOUT1_DIVIDE  (5)
+	) mmcm (
+		.CLKIN1  (clk          ),
+		.CLKFBIN (clk_fb       ),
+		.CLKFBOUT(clk_fb       ),
+		.CLKOUT0 (clk_cpu_unbuf),
+		.CLKOUT1 (clk_smz_unbuf),
+		.LOCKED  (locked       ),
+		.PWRDWN  (1'b0         ),
+		.RST     (1'b0         )
+	);
+
+	BUFG bufg_cpu (.I(clk_cpu_unbuf), .O(clk_cpu));
+	BUFG bufg_smz (.I(clk_smz_unbuf), .O(clk_smz));
+
+	reg [1:0] resetn_q = 0;
+	always @(posedge clk_cpu)
+		resetn_q <= {resetn_q[0], resetn && locked};
+
+	system #(
+		.SMZ_CLK2X(SMZ_CLK2X)
+	) sys (
+		.clk        (clk_cpu    ),
+		.clk2x      (clk_smz    ),
+		.resetn     (resetn_q[1]),
+		.trap       (trap       ),
+		.out_byte   (out_byte   ),
+		.out_byte_en(out_byte_en)
+	);
+endmodule
@@ -4,6 +4,14 @@ module system_tb;
 	reg clk = 1;
 	always #5 clk = ~clk;
 
+`ifdef SYSTEM_SMZ
+	parameter SMZ_CLK2X = 0;
+	parameter SMZ_MEM_WIDTH = 32;
+
+	reg clk2x = 1;
+	always #2.5 clk2x = ~clk2x;
+`endif
+
 	reg resetn = 0;
 	initial begin
 		if ($test$plusargs("vcd")) begin
@@ -18,20 +26,52 @@ module system_tb;
 	wire [7:0] out_byte;
 	wire out_byte_en;
 
+`ifdef SYSTEM_SMZ
+	system #(
+		.SMZ_CLK2X(SMZ_CLK2X),
+		.SMZ_MEM_WIDTH(SMZ_MEM_WIDTH)
+	) uut (
+		.clk        (clk        ),
+		.clk2x      (clk2x      ),
+`else
 	system uut (
 		.clk        (clk        ),
+`endif
 		.resetn     (resetn     ),
 		.trap       (trap       ),
 		.out_byte   (out_byte   ),
 		.out_byte_en(out_byte_en)
 	);
 
+`ifdef SYSTEM_SMZ
+	integer cycles = 0;
+	always @(posedge clk)
+		if (resetn) cycles <= cycles + 1;
+
+	// secure (upper half) reads of the core and on the memory bus
+	integer secure_reads = 0, secure_mem_reads = 0;
+	always @(posedge clk) begin
+		if (uut.picorv32_core.internal_mem_valid && uut.picorv32_core.internal_mem_ready &&
+				!uut.picorv32_core.internal_mem_wstrb && uut.picorv32_core.internal_mem_addr >= 4 * uut.MEM_SIZE / 2)
+			secure_reads <= secure_reads + 1;
+		if (uut.mem_valid && uut.mem_ready && !uut.mem_wstrb && uut.mem_addr >= 4 * uut.MEM_SIZE / 2)
+			secure_mem_reads <= secure_mem_reads + 1;
+	end
+`endif
+
 	always @(posedge clk) begin
 		if (resetn && out_byte_en) begin
 			$write("%c", out_byte);
 			$fflush;
 		end
 		if (resetn && trap) begin
+`ifdef SYSTEM_SMZ
+			$display("TRAP after %1d clock cycles, SMZ cipher on %s, %1d bit memory bus", cycles,
+					SMZ_CLK2X ? "clk2x" : "clk", SMZ_MEM_WIDTH);
+			$display("CPI: %1.3f", cycles / $itor(uut.picorv32_core.cpu_core.count_instr));
+			$display("SMZ: %1d secure reads, %1d on the memory bus, %1.2f words per memory read",
+					secure_reads, secure_mem_reads, secure_reads / $itor(secure_mem_reads));
+`endif
 			$finish;
 		end
 	end
@@ -7,6 +7,10 @@ elf_filename = sys.argv[2]
 
 insns = dict()
 
+# ENABLE_SMZ_TRACE records, see TRACE_SMZ_* in picorv32.v
+smz_events = {1: "load", 2: "store", 3: "fetch", 4: "config"}
+smz_stats = dict()
+
 with subprocess.Popen(["riscv32-unknown-elf-objdump", "-d", elf_filename], stdout=subprocess.PIPE) as proc:
     while True:
         line = proc.stdout.readline().decode("ascii")
@@ -23,6 +27,23 @@ with open(trace_filename, "r") as f:
         irq_active = (raw_data & 0x800000000) != 0
         is_addr = (raw_data & 0x200000000) != 0
         is_branch = (raw_data & 0x100000000) != 0
+        is_smz = (raw_data & 0x400000000) != 0
+
+        if is_smz:
+            kind = smz_events.get(payload >> 28, "unknown")
+            if kind == "config":
+                print("%s SMZ %s csr=0x%03x value=0x%07x" % ("IRQ" if irq_active else "   ", kind,
+                        0x200 + ((payload >> 26) & 3), payload & 0x3ffffff))
+            else:
+                hit, miss, stall = (payload >> 26) & 1, (payload >> 27) & 1, payload & 0x3ffffff
+                print("%s SMZ %s stall=%d%s" % ("IRQ" if irq_active else "   ", kind, stall,
+                        " hit" if hit else " miss" if miss else ""))
+                stats = smz_stats.setdefault(kind, [0, 0, 0, 0])
+                stats[0] += 1
+                stats[1] += stall
+                stats[2] += hit
+                stats[3] += miss
+            continue
         info = "%s %s%08x" % ("IRQ" if irq_active or last_irq else "   ",
                 ">" if is_branch else "@" if is_addr else "=", payload)
 
@@ -64,3 +85,8 @@ with open(trace_filename, "r") as f:
 
         last_irq = irq_active
 
+if smz_stats:
+    print()
+    print("SMZ     records  stall cycles  cache hits  cache misses")
+    for kind, (count, stall, hits, misses) in sorted(smz_stats.items()):
+        print("%-6s %8d %13d %11d %13d" % (kind, count, stall, hits, misses))
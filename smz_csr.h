@@ -18,6 +18,8 @@
 #define CSR_SMZ_BASE    0x200   /**< SMZ base address CSR */
 #define CSR_SMZ_SIZE    0x201   /**< SMZ region size CSR */
 #define CSR_SMZ_ENABLE  0x202   /**< SMZ enable flag CSR */
+#define CSR_SMZ_ECC_CORRECTED     0x203   /**< Corrected ECC errors (SMZ_ECC) */
+#define CSR_SMZ_ECC_UNCORRECTABLE 0x204   /**< Uncorrectable ECC errors (SMZ_ECC) */
 
 /* ===================================================================
  * CSR Read/Write Macros
@@ -146,6 +148,26 @@
  */
 #define smz_is_enabled() (read_csr(CSR_SMZ_ENABLE) & 1)
 
+/**
+ * Read the number of secure reads with a corrected single bit error
+ * (saturates at 0xffffffff, requires SMZ_ECC)
+ */
+#define smz_ecc_corrected() read_csr(CSR_SMZ_ECC_CORRECTED)
+
+/**
+ * Read the number of secure reads with an uncorrectable error
+ * (saturates at 0xffffffff, requires SMZ_ECC)
+ */
+#define smz_ecc_uncorrectable() read_csr(CSR_SMZ_ECC_UNCORRECTABLE)
+
+/**
+ * Reset both ECC error counters to zero
+ */
+#define smz_ecc_clear() ({                                  \
+    write_csr(CSR_SMZ_ECC_CORRECTED, 0);                    \
+    write_csr(CSR_SMZ_ECC_UNCORRECTABLE, 0);                \
+})
+
 /* ===================================================================
  * Utility Functions
  * =================================================================== */
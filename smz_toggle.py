@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+#
+# Toggle counts of picorv32_smz with and without CIPHER_GATING.
+#
+#   smz_toggle.py [testbench_toggle.dat] [--signals N]
+#
+# Reads the Verilator toggle coverage written by testbench_verilator_toggle
+# (make test_verilator_smz_toggle) and sums the toggles of the two
+# picorv32_smz instances of each smz_toggle_pair in testbench.v, pair[0]
+# without and pair[1] with CIPHER_GATING. Both see the same memory traffic,
+# so the difference is what the gating saves. --signals lists the signals
+# with the largest savings.
+#
+
+import argparse, re, sys
+
+parser = argparse.ArgumentParser(description="SMZ cipher gating toggle report")
+parser.add_argument("coverage", nargs="?", default="testbench_toggle.dat")
+parser.add_argument("--signals", type=int, default=0, help="list the N signals with the largest savings")
+args = parser.parse_args()
+
+# (pair, gated): total, (pair, signal): [ungated, gated]
+totals = {}
+signals = {}
+
+try:
+    f = open(args.coverage, encoding="latin-1")
+except OSError as e:
+    sys.exit("smz_toggle: %s" % e)
+with f:
+    for line in f:
+        m = re.match(r"^C '(.*)' (\d+)$", line.rstrip("\n"))
+        if not m:
+            continue
+        point = dict(kv.split("\x02", 1) for kv in m.group(1).split("\x01") if "\x02" in kv)
+        if not point.get("page", "").startswith("v_toggle"):
+            continue
+        h = re.search(r"smz_toggle_(\w+)\.pair(?:\[|__BRA__)([01])(?:\]|__KET__)\.smz(.*)", point.get("h", ""))
+        if not h:
+            continue
+        pair, gated, count = h.group(1), int(h.group(2)), int(m.group(2))
+        totals[(pair, gated)] = totals.get((pair, gated), 0) + count
+        name = re.sub(r"\[\d+\]$", "", (h.group(3) + "." + point.get("o", "")).lstrip("."))
+        signals.setdefault((pair, name), [0, 0])[gated] += count
+
+if not totals:
+    sys.exit("smz_toggle: no smz_toggle_pair toggles in %s (not a testbench_verilator_toggle run?)" % args.coverage)
+
+print("%-8s %14s %14s %10s" % ("cipher", "ungated", "gated", "saved"))
+for pair in sorted(set(p for p, _ in totals)):
+    ungated, gated = totals.get((pair, 0), 0), totals.get((pair, 1), 0)
+    print("%-8s %14d %14d %9.1f%%" % (pair, ungated, gated, 100.0 * (ungated - gated) / ungated if ungated else 0.0))
+
+if args.signals:
+    print()
+    print("%-8s %-40s %14s %14s" % ("cipher", "signal", "ungated", "gated"))
+    ranked = sorted(signals.items(), key=lambda kv: kv[1][1] - kv[1][0])
+    for (pair, name), (ungated, gated) in ranked[:args.signals]:
+        print("%-8s %-40s %14d %14d" % (pair, name, ungated, gated))
@@ -1,5 +1,806 @@
 #include "Vpicorv32_wrapper.h"
+#include "Vpicorv32_wrapper___024root.h"
 #include "verilated_vcd_c.h"
+#if VM_COVERAGE
+#include "verilated_cov.h"
+#endif
+#include "testbench_iss.h"
+#include "testbench_dev.h"
+#include "testbench_mem.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// memory of axi4_memory (testbench_mem.h) and public signals of
+// picorv32_wrapper (see /* verilator public */ in testbench.v)
+#define TB_MEMORY        (tb_mem_words())
+#define TB_SMZ_CACHE_TAG (top->rootp->picorv32_wrapper__DOT__mem__DOT__smz_cache_tag)
+#define TB_SMZ_LATENCY   (top->rootp->picorv32_wrapper__DOT__mem__DOT__smz_latency)
+#define TB_SMZ_CACHE_LINES  (top->rootp->picorv32_wrapper__DOT__mem__DOT__smz_cache_lines)
+#define TB_SMZ_CACHE_HITS   (top->rootp->picorv32_wrapper__DOT__mem__DOT__smz_cache_hits)
+#define TB_SMZ_CACHE_MISSES (top->rootp->picorv32_wrapper__DOT__mem__DOT__smz_cache_misses)
+#define TB_SMZ_BASE      (top->rootp->picorv32_wrapper__DOT__smz_base)
+#define TB_SMZ_SIZE      (top->rootp->picorv32_wrapper__DOT__smz_size)
+#define TB_SMZ_ENABLE    (top->rootp->picorv32_wrapper__DOT__smz_enable)
+#define TB_SMZ_CIPHER    (top->rootp->picorv32_wrapper__DOT__smz_cipher)
+#define TB_SMZ_KEY_0     (top->rootp->picorv32_wrapper__DOT__smz_key_0)
+#define TB_SMZ_KEY_1     (top->rootp->picorv32_wrapper__DOT__smz_key_1)
+#define TB_SMZ_KEY_2     (top->rootp->picorv32_wrapper__DOT__smz_key_2)
+#define TB_SMZ_KEY_3     (top->rootp->picorv32_wrapper__DOT__smz_key_3)
+#define TB_TESTS_PASSED  (top->rootp->picorv32_wrapper__DOT__tests_passed)
+#define TB_INSN_LAUNCH   (top->rootp->picorv32_wrapper__DOT__insn_launch)
+#define TB_INSN_ADDR     (top->rootp->picorv32_wrapper__DOT__insn_addr)
+
+#define TRACE_BRANCH (1ULL << 32)
+
+// Hybrid fast-forward (+iss=<n>): run the first <n> instructions in the
+// functional ISS, then copy memory and the SMZ keystream cache tags into the
+// model and load the architectural state with a boot stub. The stub (at
+// address 0, or at the top of memory if the handoff PC is within its reach)
+// writes the SMZ CSRs, q0..q3, the IRQ mask, the timer and x1..x31 and then
+// jumps to the handoff PC, where testbench.cc restores the memory under the
+// stub. The RTL cycle and instruction counters start from zero after the
+// stub, and pending interrupts that are masked at the handoff are dropped.
+
+// The SMZ configuration of axi4_memory is set from the +smz_* plusargs by
+// testbench.v at time 0 (when the firmware image is also encrypted for the
+// region). A harness can read or change it with the TB_SMZ_* registers.
+
+static smz_cipher tb_smz_cipher(Vpicorv32_wrapper *top)
+{
+	smz_cipher c = { (smz_mode)TB_SMZ_CIPHER, { TB_SMZ_KEY_0, TB_SMZ_KEY_1, TB_SMZ_KEY_2, TB_SMZ_KEY_3 }, 0 };
+	return c;
+}
+
+static uint32_t handoff_pc;
+static std::vector<std::pair<uint32_t, uint32_t>> handoff_saved;
+
+static uint32_t smz_raw(picorv32_iss &iss, uint32_t addr, uint32_t data)
+{
+	if (iss.mem_smz_enable)
+		smz_crypt_region(iss.mem_smz_cipher, &data, 1, addr, iss.mem_smz_base, iss.mem_smz_size);
+	return data;
+}
+
+static void handoff_poke(Vpicorv32_wrapper *top, picorv32_iss &iss, uint32_t addr, uint32_t data)
+{
+	handoff_saved.push_back(std::make_pair(addr, (uint32_t)TB_MEMORY[addr >> 2]));
+	TB_MEMORY[addr >> 2] = smz_raw(iss, addr, data);
+}
+
+static uint32_t enc_i(uint32_t imm, int rs1, int f3, int rd, int op)
+{
+	return (imm & 0xfff) << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+}
+
+static uint32_t enc_custom0(int f7, int rs1, int f3, int rd)
+{
+	return f7 << 25 | rs1 << 15 | f3 << 12 | rd << 7 | 0x0b;
+}
+
+static uint32_t enc_jal(uint32_t from, uint32_t to)
+{
+	uint32_t imm = to - from;
+	return ((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3ff) << 21 | ((imm >> 11) & 1) << 20 |
+			((imm >> 12) & 0xff) << 12 | 0x6f;
+}
+
+static bool iss_handoff(Vpicorv32_wrapper *top, uint64_t insns)
+{
+	picorv32_iss iss;
+	const int mem_words = TB_MEM_WORDS;
+
+	const char *flag_cpi = Verilated::commandArgsPlusMatch("iss_cpi=");
+	if (flag_cpi && *flag_cpi)
+		iss.cpi = atoi(flag_cpi + strlen("+iss_cpi="));
+	const char *flag_lines = Verilated::commandArgsPlusMatch("smz_cache_lines=");
+	if (flag_lines && *flag_lines)
+		iss.smz_cache_tag.assign(atoi(flag_lines + strlen("+smz_cache_lines=")), 0);
+
+	iss.mem_smz_base = TB_SMZ_BASE;
+	iss.mem_smz_size = TB_SMZ_SIZE;
+	iss.mem_smz_enable = TB_SMZ_ENABLE;
+	iss.mem_smz_cipher = tb_smz_cipher(top);
+	for (int i = 0; i < mem_words; i++)
+		iss.memory[i] = TB_MEMORY[i];
+
+	clock_t start = clock();
+	uint64_t n = iss.run(insns);
+	printf("ISS: %llu instructions, ~%llu cycles, %.2f s, pc=%08x\n", (unsigned long long)n,
+			(unsigned long long)iss.cycle, (double)(clock() - start) / CLOCKS_PER_SEC, iss.pc);
+
+	if (iss.trapped) {
+		printf("ISS: TRAP before the handoff point.\n");
+		if (iss.tests_passed)
+			printf("ALL TESTS PASSED.\n");
+		return false;
+	}
+	if (iss.irq_pending)
+		printf("ISS: dropping masked pending IRQs %08x at the handoff.\n", iss.irq_pending);
+
+	// only the words that changed, the rest stays shared (testbench_mem.h)
+	for (int i = 0; i < mem_words; i++)
+		if (TB_MEMORY[i] != iss.memory[i])
+			TB_MEMORY[i] = iss.memory[i];
+	for (size_t i = 0; i < iss.smz_cache_tag.size() && i < 256; i++)
+		TB_SMZ_CACHE_TAG[i] = iss.smz_cache_tag[i];
+
+	// stub code followed by its data: x0..x31, q0..q3, smz base/size/enable, timer, irq mask
+	std::vector<uint32_t> code, data(iss.regs, iss.regs + 32);
+	data.insert(data.end(), iss.qregs, iss.qregs + 4);
+	data.push_back(iss.smz_base);
+	data.push_back(iss.smz_size);
+	data.push_back(iss.smz_enable);
+	data.push_back(iss.timer);
+	data.push_back(iss.irq_mask);
+
+	const int stub_words = 2 + 3*2 + 4*2 + 30 + 3*2 + 2 + 1;
+	const uint32_t stub_bytes = 4 * (stub_words + data.size());
+	uint32_t stub = 0;
+	if (iss.pc < 4) {
+		printf("ISS: can't hand off at the reset vector.\n");
+		return false;
+	}
+	if (iss.pc < stub_bytes)
+		stub = 4 * mem_words - stub_bytes;
+	uint32_t data_addr = stub + 4 * stub_words;
+
+	// lui x31 + lw x31 of data word i, needs no other register
+	auto load_x31 = [&](int i) {
+		uint32_t addr = data_addr + 4 * i;
+		code.push_back(((addr + 0x800) & 0xfffff000) | 31 << 7 | 0x37);
+		code.push_back(enc_i(addr, 31, 2, 31, 0x03));
+	};
+
+	code.push_back(((data_addr + 0x800) & 0xfffff000) | 31 << 7 | 0x37);  // lui x31
+	code.push_back(enc_i(data_addr, 31, 0, 31, 0x13));                    // addi x31, x31
+	for (int i = 0; i < 3; i++) {
+		code.push_back(enc_i(4 * (36 + i), 31, 2, 1, 0x03));          // lw x1
+		code.push_back(enc_i(0x200 + i, 1, 1, 0, 0x73));              // csrrw zero, smz_*, x1
+	}
+	for (int i = 0; i < 4; i++) {
+		code.push_back(enc_i(4 * (32 + i), 31, 2, 1, 0x03));
+		code.push_back(enc_custom0(1, 1, 2, i));                      // setq qi, x1
+	}
+	for (int i = 1; i < 31; i++)
+		code.push_back(enc_i(4 * i, 31, 2, i, 0x03));                 // lw xi
+
+	// the IRQ mask keeps its reset value (all masked) until x1..x30 are
+	// loaded, and x31 is reloaded last, so an IRQ taken in the last stub
+	// instructions finds the ISS registers and returns into the stub
+	load_x31(40);
+	code.push_back(enc_custom0(3, 31, 6, 0));                             // maskirq zero, x31
+	load_x31(39);
+	code.push_back(enc_custom0(5, 31, 6, 0));                             // timer zero, x31
+	load_x31(31);
+	code.push_back(enc_jal(stub + 4 * code.size(), iss.pc));
+
+	if (stub)
+		handoff_poke(top, iss, 0, enc_jal(0, stub));
+	for (size_t i = 0; i < code.size(); i++)
+		handoff_poke(top, iss, stub + 4*i, code[i]);
+	for (size_t i = 0; i < data.size(); i++)
+		handoff_poke(top, iss, data_addr + 4*i, data[i]);
+
+	handoff_pc = iss.pc;
+	return true;
+}
+
+// Runs job(i) for i < n in forked children of the current model state (the
+// memory of the children is copy-on-write), at most jobs at a time. Each
+// child sends its result back through a pipe; results[i] is crashed if the
+// child died before that. Returns the number of jobs that were started.
+template <typename R, typename F>
+static uint64_t fork_jobs(uint64_t n, int jobs, std::vector<R> &results, const R &crashed, F job)
+{
+	std::vector<std::pair<pid_t, int>> running;   // pid, pipe fd
+	std::vector<uint64_t> running_index;
+	uint64_t next = 0;
+	int fds[2];
+
+	results.assign(n, crashed);
+	fflush(stdout);
+	while (next < n || !running.empty()) {
+		while (next < n && (int)running.size() < jobs) {
+			if (pipe(fds) < 0) {
+				perror("pipe");
+				break;
+			}
+			pid_t pid = fork();
+			if (pid == 0) {
+				close(fds[0]);
+				R r = job(next);
+				if (write(fds[1], &r, sizeof(r)) < 0)
+					_exit(1);
+				_exit(0);
+			}
+			close(fds[1]);
+			if (pid < 0) {
+				perror("fork");
+				close(fds[0]);
+				break;
+			}
+			running.push_back(std::make_pair(pid, fds[0]));
+			running_index.push_back(next++);
+		}
+		if (running.empty())
+			break;
+
+		pid_t pid = wait(NULL);
+		for (size_t i = 0; i < running.size(); i++) {
+			if (running[i].first != pid)
+				continue;
+			R &r = results[running_index[i]];
+			if (read(running[i].second, &r, sizeof(r)) != sizeof(r))
+				r = crashed;
+			close(running[i].second);
+			running.erase(running.begin() + i);
+			running_index.erase(running_index.begin() + i);
+			break;
+		}
+	}
+	return next;
+}
+
+// Fault-injection campaign (+fault_campaign=<n>): run the model up to cycle
+// +fault_start=<c> after reset, then use fork() as a checkpoint and run <n>
+// workers (+fault_jobs=<j> at a time) from that state. Each worker flips one
+// bit at a random cycle in [c, c + +fault_window=<w>) and runs to the trap.
+// Targets (+fault_target=mem|smz|all) are the memory words of the SMZ region
+// (all of memory if the region is outside it), and the SMZ state of the
+// testbench: the smz_base/size/enable registers and the keystream cache tags.
+// Outcomes are compared against a golden worker without injection and listed
+// per injection in testbench.faults.
+
+enum { FAULT_MASKED, FAULT_SDC, FAULT_DETECTED, FAULT_HANG, FAULT_CRASH, FAULT_OUTCOMES };
+static const char *fault_outcome_names[FAULT_OUTCOMES] = { "masked", "sdc", "detected", "hang", "crash" };
+
+enum { FAULT_MEM, FAULT_SMZ_BASE, FAULT_SMZ_SIZE, FAULT_SMZ_ENABLE, FAULT_SMZ_CACHE_TAG };
+static const char *fault_target_names[] = { "mem", "smz_base", "smz_size", "smz_enable", "smz_cache_tag" };
+
+struct fault_injection {
+	uint64_t cycle;
+	int target;
+	uint32_t index;
+	int bit;
+};
+
+struct fault_result {
+	int outcome;
+	uint64_t cycles;
+	uint64_t output_hash;
+};
+
+static uint64_t fault_rng(uint64_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static void fault_inject(Vpicorv32_wrapper *top, const fault_injection &f)
+{
+	switch (f.target) {
+	case FAULT_MEM:           TB_MEMORY[f.index] ^= 1u << f.bit; break;
+	case FAULT_SMZ_BASE:      TB_SMZ_BASE ^= 1u << f.bit; break;
+	case FAULT_SMZ_SIZE:      TB_SMZ_SIZE ^= 1u << f.bit; break;
+	case FAULT_SMZ_ENABLE:    TB_SMZ_ENABLE ^= 1; break;
+	case FAULT_SMZ_CACHE_TAG: TB_SMZ_CACHE_TAG[f.index] ^= 1u << f.bit; break;
+	}
+}
+
+// worker process: runs from the checkpoint (after the posedge of cycle
+// start) for at most max_cycles, with stdout captured for the comparison
+static fault_result fault_worker(Vpicorv32_wrapper *top, const fault_injection *f, uint64_t start, uint64_t max_cycles)
+{
+	fault_result r = { FAULT_HANG, 0, 14695981039346656037ULL };
+
+	fflush(stdout);
+	FILE *out = tmpfile();
+	dup2(fileno(out), 1);
+
+	for (uint64_t cycle = start; r.cycles < max_cycles; r.cycles++) {
+		if (f && cycle == f->cycle)
+			fault_inject(top, *f);
+		top->clk = 0;
+		top->eval();
+		top->clk = 1;
+		top->eval();
+		cycle++;
+		if (Verilated::gotFinish()) {
+			r.outcome = FAULT_DETECTED;
+			break;
+		}
+		// the wrapper reports the trap at the next posedge, stop before that
+		if (top->trap) {
+			r.outcome = TB_TESTS_PASSED ? FAULT_MASKED : FAULT_DETECTED;
+			break;
+		}
+	}
+
+	fflush(stdout);
+	rewind(out);
+	for (int c; (c = fgetc(out)) != EOF;)
+		r.output_hash = (r.output_hash ^ (uint8_t)c) * 1099511628211ULL;
+	return r;
+}
+
+static void fault_campaign(Vpicorv32_wrapper *top, uint64_t injections, uint64_t start)
+{
+	const char *flag;
+	uint64_t window = 1000, seed = 1;
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN), cache_lines = 0;
+	bool target_mem = true, target_smz = true;
+
+	if ((flag = Verilated::commandArgsPlusMatch("fault_window=")) && *flag)
+		window = strtoull(flag + strlen("+fault_window="), NULL, 0);
+	if ((flag = Verilated::commandArgsPlusMatch("fault_jobs=")) && *flag)
+		jobs = atoi(flag + strlen("+fault_jobs="));
+	if ((flag = Verilated::commandArgsPlusMatch("fault_seed=")) && *flag)
+		seed = strtoull(flag + strlen("+fault_seed="), NULL, 0);
+	if ((flag = Verilated::commandArgsPlusMatch("fault_target=")) && *flag) {
+		target_mem = !strcmp(flag, "+fault_target=mem") || !strcmp(flag, "+fault_target=all");
+		target_smz = !strcmp(flag, "+fault_target=smz") || !strcmp(flag, "+fault_target=all");
+	}
+	cache_lines = std::min((int)TB_SMZ_CACHE_LINES, 256);
+	if (jobs < 1)
+		jobs = 1;
+	if (window < 1)
+		window = 1;
+	if (!target_mem && !target_smz) {
+		printf("FAULT: unknown +fault_target, expected mem, smz or all.\n");
+		return;
+	}
+
+	// memory words that can be hit: the SMZ region, or all of memory
+	const uint32_t mem_words = TB_MEM_WORDS;
+	uint32_t mem_first = 0, mem_last = mem_words;
+	if (TB_SMZ_ENABLE && TB_SMZ_BASE / 4 < mem_words) {
+		mem_first = TB_SMZ_BASE / 4;
+		mem_last = std::min((uint64_t)mem_words, ((uint64_t)TB_SMZ_BASE + TB_SMZ_SIZE + 3) / 4);
+		if (mem_last <= mem_first)
+			mem_first = 0, mem_last = mem_words;
+	}
+
+	// golden run from the checkpoint
+	const fault_result crashed = { FAULT_CRASH, 0, 0 };
+	std::vector<fault_result> golden_run;
+	fork_jobs(1, 1, golden_run, crashed, [&](uint64_t) {
+		return fault_worker(top, NULL, start, UINT64_MAX);
+	});
+	const fault_result golden = golden_run[0];
+	if (golden.outcome != FAULT_MASKED) {
+		printf("FAULT: golden run from cycle %llu did not pass.\n", (unsigned long long)start);
+		return;
+	}
+	printf("FAULT: golden run from cycle %llu traps after %llu cycles.\n", (unsigned long long)start,
+			(unsigned long long)golden.cycles);
+
+	// a fault that more than doubles the run time is a hang
+	const uint64_t max_cycles = 2 * (golden.cycles + window) + 1000;
+
+	std::vector<fault_injection> plan(injections);
+	uint64_t rng = seed ? seed : 1;
+	for (auto &f : plan) {
+		f.cycle = start + fault_rng(rng) % window;
+		int target = FAULT_MEM;
+		if (target_smz && (!target_mem || fault_rng(rng) % 2))
+			target = FAULT_SMZ_BASE + fault_rng(rng) % (cache_lines ? 4 : 3);
+		f.target = target;
+		f.index = target == FAULT_MEM ? mem_first + fault_rng(rng) % (mem_last - mem_first) :
+				target == FAULT_SMZ_CACHE_TAG ? fault_rng(rng) % cache_lines : 0;
+		f.bit = fault_rng(rng) % 32;
+	}
+
+	std::vector<fault_result> results;
+	auto t0 = std::chrono::steady_clock::now();
+	uint64_t next = fork_jobs(injections, jobs, results, crashed, [&](uint64_t i) {
+		fault_result r = fault_worker(top, &plan[i], start, max_cycles);
+		if (r.outcome == FAULT_MASKED && r.output_hash != golden.output_hash)
+			r.outcome = FAULT_SDC;
+		return r;
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	uint64_t count[FAULT_OUTCOMES] = { };
+	FILE *log_fd = fopen("testbench.faults", "w");
+	for (uint64_t i = 0; i < next; i++) {
+		const fault_injection &f = plan[i];
+		count[results[i].outcome]++;
+		if (log_fd)
+			fprintf(log_fd, "%llu %llu %s %u %d %s %llu\n", (unsigned long long)i, (unsigned long long)f.cycle,
+					fault_target_names[f.target], f.index, f.bit, fault_outcome_names[results[i].outcome],
+					(unsigned long long)results[i].cycles);
+	}
+	if (log_fd)
+		fclose(log_fd);
+
+	printf("FAULT: %llu injections in %.2f s with %d jobs, %.1f injections/s.\n", (unsigned long long)next,
+			seconds, jobs, seconds > 0 ? next / seconds : 0.0);
+	for (int i = 0; i < FAULT_OUTCOMES; i++)
+		printf("FAULT: %-9s %8llu  %5.1f%%\n", fault_outcome_names[i], (unsigned long long)count[i],
+				next ? 100.0 * count[i] / next : 0.0);
+}
+
+// What-if exploration (+whatif=<c>): run the model up to cycle <c> after
+// reset, then fork one child per variant of +whatif_set=<v1>/<v2>/... (at
+// most +whatif_jobs=<j> at a time, memory is copy-on-write). A variant is a
+// comma separated list of SMZ settings that the child applies before running
+// to the trap: enable=<0|1>, base=<hex>, size=<hex>, cipher=<0|1>,
+// key=<128 bit hex>, latency=<cycles> and cache_lines=<n>. Memory is
+// re-encrypted for a changed region, cipher or key, and the keystream cache
+// is emptied when its lines change. An unchanged baseline child runs as well
+// and the results are printed as one table relative to it.
+
+struct whatif_variant {
+	std::string name;
+	bool set_enable, set_base, set_size, set_cipher, set_key, set_latency, set_cache_lines;
+	uint32_t enable, base, size, cipher, key[4], latency, cache_lines;
+};
+
+struct whatif_result {
+	fault_result run;
+	uint64_t cache_hits, cache_misses;
+};
+
+static bool whatif_parse(const std::string &spec, whatif_variant &v)
+{
+	v = whatif_variant();
+	v.name = spec.empty() ? "baseline" : spec;
+	for (size_t pos = 0; pos < spec.size();) {
+		size_t end = spec.find(',', pos);
+		if (end == std::string::npos)
+			end = spec.size();
+		std::string item = spec.substr(pos, end - pos);
+		pos = end + 1;
+		size_t eq = item.find('=');
+		if (eq == std::string::npos || eq + 1 == item.size())
+			return false;
+		std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+		char *p;
+		if (key == "key") {
+			if (value.size() > 32 || value.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+				return false;
+			value = std::string(32 - value.size(), '0') + value;
+			for (int i = 0; i < 4; i++)
+				v.key[i] = strtoul(value.substr(8 * i, 8).c_str(), NULL, 16);
+			v.set_key = true;
+			continue;
+		}
+		bool hex = key == "base" || key == "size";
+		uint32_t n = strtoul(value.c_str(), &p, hex ? 16 : 0);
+		if (*p)
+			return false;
+		if (key == "enable" && n <= 1)
+			v.enable = n, v.set_enable = true;
+		else if (key == "base")
+			v.base = n, v.set_base = true;
+		else if (key == "size")
+			v.size = n, v.set_size = true;
+		else if (key == "cipher" && n <= 1)
+			v.cipher = n, v.set_cipher = true;
+		else if (key == "latency")
+			v.latency = n, v.set_latency = true;
+		else if (key == "cache_lines" && n <= 256 && !(n & (n - 1)))
+			v.cache_lines = n, v.set_cache_lines = true;
+		else
+			return false;
+	}
+	return true;
+}
+
+static void whatif_apply(Vpicorv32_wrapper *top, const whatif_variant &v)
+{
+	const uint32_t mem_words = TB_MEM_WORDS;
+	smz_cipher old_cipher = tb_smz_cipher(top);
+	uint32_t old_enable = TB_SMZ_ENABLE, old_base = TB_SMZ_BASE, old_size = TB_SMZ_SIZE;
+
+	if (v.set_enable)
+		TB_SMZ_ENABLE = v.enable;
+	if (v.set_base)
+		TB_SMZ_BASE = v.base;
+	if (v.set_size)
+		TB_SMZ_SIZE = v.size;
+	if (v.set_cipher)
+		TB_SMZ_CIPHER = v.cipher;
+	if (v.set_key) {
+		TB_SMZ_KEY_0 = v.key[0];
+		TB_SMZ_KEY_1 = v.key[1];
+		TB_SMZ_KEY_2 = v.key[2];
+		TB_SMZ_KEY_3 = v.key[3];
+	}
+	if (v.set_latency)
+		TB_SMZ_LATENCY = v.latency;
+	if (v.set_cache_lines && (uint32_t)TB_SMZ_CACHE_LINES != v.cache_lines) {
+		TB_SMZ_CACHE_LINES = v.cache_lines;
+		for (int i = 0; i < 256; i++)
+			TB_SMZ_CACHE_TAG[i] = 0;
+	}
+
+	// memory holds ciphertext of the old configuration
+	if (v.set_enable || v.set_base || v.set_size || v.set_cipher || v.set_key) {
+		std::vector<uint32_t> words(mem_words);
+		for (uint32_t i = 0; i < mem_words; i++)
+			words[i] = TB_MEMORY[i];
+		if (old_enable)
+			smz_crypt_region(old_cipher, words.data(), mem_words, 0, old_base, old_size);
+		if (TB_SMZ_ENABLE)
+			smz_crypt_region(tb_smz_cipher(top), words.data(), mem_words, 0, TB_SMZ_BASE, TB_SMZ_SIZE);
+		for (uint32_t i = 0; i < mem_words; i++)
+			if (TB_MEMORY[i] != words[i])
+				TB_MEMORY[i] = words[i];
+		for (int i = 0; i < 256; i++)
+			TB_SMZ_CACHE_TAG[i] = 0;
+	}
+}
+
+static void whatif_explore(Vpicorv32_wrapper *top, uint64_t start)
+{
+	const char *flag;
+	uint64_t max_cycles = 10000000;
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	std::string set;
+
+	if ((flag = Verilated::commandArgsPlusMatch("whatif_set=")) && *flag)
+		set = flag + strlen("+whatif_set=");
+	if ((flag = Verilated::commandArgsPlusMatch("whatif_jobs=")) && *flag)
+		jobs = atoi(flag + strlen("+whatif_jobs="));
+	if ((flag = Verilated::commandArgsPlusMatch("whatif_max_cycles=")) && *flag)
+		max_cycles = strtoull(flag + strlen("+whatif_max_cycles="), NULL, 0);
+	if (jobs < 1)
+		jobs = 1;
+
+	// variant 0 is the baseline
+	std::vector<whatif_variant> variants(1);
+	whatif_parse("", variants[0]);
+	for (size_t pos = 0; pos < set.size();) {
+		size_t end = set.find('/', pos);
+		if (end == std::string::npos)
+			end = set.size();
+		whatif_variant v;
+		if (!whatif_parse(set.substr(pos, end - pos), v)) {
+			printf("WHATIF: bad variant '%s' in +whatif_set.\n", set.substr(pos, end - pos).c_str());
+			return;
+		}
+		variants.push_back(v);
+		pos = end + 1;
+	}
+
+	const whatif_result crashed = { { FAULT_CRASH, 0, 0 }, 0, 0 };
+	std::vector<whatif_result> results;
+	auto t0 = std::chrono::steady_clock::now();
+	fork_jobs(variants.size(), jobs, results, crashed, [&](uint64_t i) {
+		whatif_apply(top, variants[i]);
+		uint64_t hits = TB_SMZ_CACHE_HITS, misses = TB_SMZ_CACHE_MISSES;
+		whatif_result r;
+		r.run = fault_worker(top, NULL, start, max_cycles);
+		r.cache_hits = TB_SMZ_CACHE_HITS - hits;
+		r.cache_misses = TB_SMZ_CACHE_MISSES - misses;
+		return r;
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+	static const char *result_names[FAULT_OUTCOMES] = { "passed", "passed", "failed", "timeout", "crash" };
+	const whatif_result &base = results[0];
+	size_t width = 8;
+	for (auto &v : variants)
+		width = std::max(width, v.name.size());
+
+	printf("WHATIF: %zu variants from cycle %llu in %.2f s with %d jobs.\n", variants.size(),
+			(unsigned long long)start, seconds, jobs);
+	printf("WHATIF: %-*s  %-7s  %10s  %8s  %10s  %10s  %s\n", (int)width, "variant", "result", "cycles",
+			"delta", "hits", "misses", "output");
+	for (size_t i = 0; i < variants.size(); i++) {
+		const whatif_result &r = results[i];
+		bool ran = r.run.outcome != FAULT_CRASH;
+		double delta = base.run.cycles ? 100.0 * ((double)r.run.cycles - base.run.cycles) / base.run.cycles : 0.0;
+		printf("WHATIF: %-*s  %-7s  %10llu  %+7.1f%%  %10llu  %10llu  %s\n", (int)width, variants[i].name.c_str(),
+				result_names[r.run.outcome], (unsigned long long)r.run.cycles, ran ? delta : 0.0,
+				(unsigned long long)r.cache_hits, (unsigned long long)r.cache_misses,
+				!ran ? "-" : r.run.output_hash == base.run.output_hash ? "same" : "differs");
+	}
+}
+
+// C++ device models (+dev_<kind>=<hex base>, see testbench_dev.h), new
+// instances in the selected device bank
+static void register_devices()
+{
+	for (const char *kind : { "timer", "rng", "smz" }) {
+		std::string arg = std::string("dev_") + kind + "=";
+		const char* flag_dev = Verilated::commandArgsPlusMatch(arg.c_str());
+		if (flag_dev && *flag_dev && !tb_dev_builtin(kind, strtoul(flag_dev + 1 + arg.size(), NULL, 16))) {
+			printf("Cannot map the %s device at %s.\n", kind, flag_dev + 1 + arg.size());
+			exit(1);
+		}
+	}
+}
+
+// Lockstep A/B comparison (+ab=<variant>): run a second model instance
+// next to the first one, with the SMZ settings of <variant> (as in
+// +whatif_set) applied to it, and +ab_a=<variant> applied to the first one.
+// Both models are stepped by instruction launch and the cycles until the
+// next launch are charged to the PC of the instruction in each model. When
+// the PCs differ (an interrupt or a timing dependent branch taken in only one
+// model), the model at the IRQ vector, or else the one with fewer cycles,
+// runs alone until it reaches the PC of the other one (at most
+// +ab_window=<n> instructions). The +ab_top=<n> PCs with the largest cycle
+// difference B - A are printed, and all PCs are listed in testbench.ab.
+// Each model has its own memory and device bank, and a $finish ends only
+// the model that ran it.
+
+struct ab_model {
+	Vpicorv32_wrapper *top;
+	int bank;
+	uint64_t cycles, insns;
+	uint32_t pc;
+	bool done;
+};
+
+struct ab_pc {
+	uint64_t insns[2], cycles[2];
+};
+
+// run to the next instruction launch, returns the cycles of the instruction
+// at the previous PC
+static uint64_t ab_step(ab_model &m)
+{
+	Vpicorv32_wrapper *top = m.top;
+	uint64_t start = m.cycles;
+
+	tb_mem_select(m.bank);
+	tb_dev_select(m.bank);
+	while (!m.done) {
+		top->clk = 0;
+		top->eval();
+		top->clk = 1;
+		top->eval();
+		m.cycles++;
+		// the finish flag is global, clear it for the other model
+		bool finished = Verilated::gotFinish();
+		if (finished)
+			Verilated::gotFinish(false);
+		// the wrapper reports the trap at the next posedge, stop before that
+		if (top->trap || finished) {
+			m.done = true;
+			break;
+		}
+		if (TB_INSN_LAUNCH) {
+			m.pc = TB_INSN_ADDR;
+			m.insns++;
+			break;
+		}
+	}
+	return m.cycles - start;
+}
+
+static void ab_lockstep(Vpicorv32_wrapper *top_a, const char *spec_b)
+{
+	const char *flag;
+	const uint32_t irq_vector = 0x10;
+	uint64_t window = 100000;
+	int top_n = 20;
+	std::string spec_a;
+
+	if ((flag = Verilated::commandArgsPlusMatch("ab_a=")) && *flag)
+		spec_a = flag + strlen("+ab_a=");
+	if ((flag = Verilated::commandArgsPlusMatch("ab_window=")) && *flag)
+		window = strtoull(flag + strlen("+ab_window="), NULL, 0);
+	if ((flag = Verilated::commandArgsPlusMatch("ab_top=")) && *flag)
+		top_n = atoi(flag + strlen("+ab_top="));
+
+	whatif_variant variant[2];
+	if (!whatif_parse(spec_a, variant[0]) || !whatif_parse(spec_b, variant[1])) {
+		printf("AB: bad variant in +ab_a or +ab.\n");
+		return;
+	}
+
+	// the initial blocks of testbench.v (plusargs, firmware image) run at
+	// the first eval, the variants are applied while in reset
+	Vpicorv32_wrapper *top_b = new Vpicorv32_wrapper;
+	tb_mem_select(1);
+	tb_dev_select(1);
+	register_devices();
+	top_b->clk = 0;
+	top_b->eval();
+	ab_model m[2] = { { top_a, 0, 0, 0, 0, false }, { top_b, 1, 0, 0, 0, false } };
+	for (int i = 0; i < 2; i++) {
+		tb_mem_select(m[i].bank);
+		tb_dev_select(m[i].bank);
+		whatif_apply(m[i].top, variant[i]);
+		for (int k = 0; k < 20; k++) {
+			m[i].top->clk = !m[i].top->clk;
+			m[i].top->eval();
+		}
+		m[i].top->resetn = 1;
+	}
+
+	// the firmware output of both models would interleave
+	fflush(stdout);
+	int saved_stdout = dup(1);
+	FILE *null_out = fopen("/dev/null", "w");
+	if (null_out)
+		dup2(fileno(null_out), 1);
+
+	std::unordered_map<uint32_t, ab_pc> pcs;
+	uint64_t aligned = 0, divergences = 0;
+	bool lost = false;
+	ab_step(m[0]);
+	ab_step(m[1]);
+	while (!m[0].done && !m[1].done) {
+		if (m[0].pc == m[1].pc) {
+			ab_pc &p = pcs[m[0].pc];
+			for (int i = 0; i < 2; i++) {
+				p.insns[i]++;
+				p.cycles[i] += ab_step(m[i]);
+			}
+			aligned++;
+			continue;
+		}
+
+		divergences++;
+		int i = m[1].pc == irq_vector ? 1 : m[0].pc == irq_vector ? 0 : m[1].cycles < m[0].cycles;
+		uint32_t target = m[!i].pc;
+		for (uint64_t n = 0; n < window && m[i].pc != target && !m[i].done; n++) {
+			ab_pc &p = pcs[m[i].pc];
+			p.insns[i]++;
+			p.cycles[i] += ab_step(m[i]);
+		}
+		if (m[i].pc != target && !m[i].done) {
+			lost = true;
+			break;
+		}
+	}
+
+	fflush(stdout);
+	dup2(saved_stdout, 1);
+	close(saved_stdout);
+	if (null_out)
+		fclose(null_out);
+
+	std::vector<std::pair<uint32_t, ab_pc>> sorted(pcs.begin(), pcs.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<uint32_t, ab_pc> &x, const std::pair<uint32_t, ab_pc> &y) {
+		int64_t dx = x.second.cycles[1] - x.second.cycles[0], dy = y.second.cycles[1] - y.second.cycles[0];
+		return dx != dy ? dx > dy : x.first < y.first;
+	});
+
+	FILE *log_fd = fopen("testbench.ab", "w");
+	if (log_fd) {
+		for (auto &e : sorted)
+			fprintf(log_fd, "%08x %llu %llu %llu %llu\n", e.first, (unsigned long long)e.second.insns[0],
+					(unsigned long long)e.second.cycles[0], (unsigned long long)e.second.insns[1],
+					(unsigned long long)e.second.cycles[1]);
+		fclose(log_fd);
+	}
+
+	tb_mem_select(0);
+	tb_dev_select(0);
+	int64_t delta = m[1].cycles - m[0].cycles;
+	printf("AB: A '%s', B '%s'\n", variant[0].name.c_str(), variant[1].name.c_str());
+	printf("AB: A %llu cycles %llu insns%s, B %llu cycles %llu insns%s, B - A %+lld cycles (%+.2f%%)\n",
+			(unsigned long long)m[0].cycles, (unsigned long long)m[0].insns, m[0].done ? "" : " (stopped)",
+			(unsigned long long)m[1].cycles, (unsigned long long)m[1].insns, m[1].done ? "" : " (stopped)",
+			(long long)delta, m[0].cycles ? 100.0 * delta / m[0].cycles : 0.0);
+	printf("AB: %llu instructions in lockstep, %llu divergences%s\n", (unsigned long long)aligned,
+			(unsigned long long)divergences, lost ? ", lost sync (see +ab_window)" : "");
+	printf("AB: %-8s  %10s %10s  %10s %10s  %9s  %6s\n", "pc", "insns A", "cycles A", "insns B", "cycles B",
+			"B - A", "share");
+	for (int k = 0; k < top_n && k < (int)sorted.size(); k++) {
+		const ab_pc &p = sorted[k].second;
+		int64_t d = p.cycles[1] - p.cycles[0];
+		if (d <= 0)
+			break;
+		printf("AB: %08x  %10llu %10llu  %10llu %10llu  %+9lld  %5.1f%%\n", sorted[k].first,
+				(unsigned long long)p.insns[0], (unsigned long long)p.cycles[0], (unsigned long long)p.insns[1],
+				(unsigned long long)p.cycles[1], (long long)d, delta > 0 ? 100.0 * d / delta : 0.0);
+	}
+	delete top_b;
+}
 
 int main(int argc, char **argv, char **env)
 {
@@ -7,6 +808,9 @@ int main(int argc, char **argv, char **env)
 	printf("Recommended: Verilator 4.0 or later.\n");
 
 	Verilated::commandArgs(argc, argv);
+
+	register_devices();
+
 	Vpicorv32_wrapper* top = new Vpicorv32_wrapper;
 
 	// Tracing (vcd)
@@ -27,6 +831,38 @@ int main(int argc, char **argv, char **env)
 	}
 
 	top->clk = 0;
+	top->eval();
+
+	// Hybrid fast-forward
+	const char* flag_iss = Verilated::commandArgsPlusMatch("iss=");
+	uint64_t iss_insns = flag_iss && *flag_iss ? strtoull(flag_iss + strlen("+iss="), NULL, 0) : 0;
+	if (iss_insns) {
+		if (!iss_handoff(top, iss_insns)) {
+			delete top;
+			exit(0);
+		}
+	}
+
+	// Lockstep A/B comparison
+	const char* flag_ab = Verilated::commandArgsPlusMatch("ab=");
+	if (flag_ab && *flag_ab) {
+		ab_lockstep(top, flag_ab + strlen("+ab="));
+		delete top;
+		exit(0);
+	}
+
+	// Fault-injection campaign
+	const char* flag_fault = Verilated::commandArgsPlusMatch("fault_campaign=");
+	uint64_t fault_injections = flag_fault && *flag_fault ? strtoull(flag_fault + strlen("+fault_campaign="), NULL, 0) : 0;
+	const char* flag_fault_start = Verilated::commandArgsPlusMatch("fault_start=");
+	uint64_t fault_start = flag_fault_start && *flag_fault_start ? strtoull(flag_fault_start + strlen("+fault_start="), NULL, 0) : 0;
+
+	// What-if exploration
+	const char* flag_whatif = Verilated::commandArgsPlusMatch("whatif=");
+	bool whatif = flag_whatif && *flag_whatif;
+	uint64_t whatif_start = whatif ? strtoull(flag_whatif + strlen("+whatif="), NULL, 0) : 0;
+	uint64_t cycles = 0;
+
 	int t = 0;
 	while (!Verilated::gotFinish()) {
 		if (t > 200)
@@ -35,10 +871,37 @@ int main(int argc, char **argv, char **env)
 		top->eval();
 		if (tfp) tfp->dump (t);
 		if (trace_fd && top->clk && top->trace_valid) fprintf(trace_fd, "%9.9lx\n", top->trace_data);
+		if (!handoff_saved.empty() && top->clk && top->trace_valid && (top->trace_data & TRACE_BRANCH) &&
+				(uint32_t)top->trace_data == handoff_pc) {
+			for (auto &w : handoff_saved)
+				TB_MEMORY[w.first >> 2] = w.second;
+			handoff_saved.clear();
+			printf("ISS: handoff to RTL at pc=%08x\n", handoff_pc);
+		}
+		if (top->clk && top->resetn) {
+			if (fault_injections && cycles == fault_start) {
+				if (tfp) tfp->close();
+				if (trace_fd) fclose(trace_fd);
+				tfp = NULL;
+				fault_campaign(top, fault_injections, fault_start);
+				break;
+			}
+			if (whatif && cycles == whatif_start) {
+				if (tfp) tfp->close();
+				if (trace_fd) fclose(trace_fd);
+				tfp = NULL;
+				whatif_explore(top, whatif_start);
+				break;
+			}
+			cycles++;
+		}
 		t += 5;
 	}
 	if (tfp) tfp->close();
+#if VM_COVERAGE
+	// toggle counts of testbench_verilator_toggle, see smz_toggle.py
+	Verilated::threadContextp()->coveragep()->write("testbench_toggle.dat");
+#endif
 	delete top;
 	exit(0);
 }
-
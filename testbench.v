@@ -28,8 +28,14 @@ module testbench #(
 			$dumpfile("testbench.vcd");
 			$dumpvars(0, testbench);
 		end
+`ifdef PCPI_CRYPTO
+		// firmware/crypto.hex adds the AES-GCM and SHA-256 benchmarks
+		repeat (2000000) @(posedge clk);
+`else
 		repeat (1000000) @(posedge clk);
+`endif
 		$display("TIMEOUT");
+		top.mem.hist_dump;
 		$finish;
 	end
 
@@ -61,6 +67,15 @@ module testbench #(
 		.trace_valid(trace_valid),
 		.trace_data(trace_data)
 	);
+
+`ifdef SIMPOINT
+`define SIMPOINT_CORE top.uut.picorv32_core
+`define SIMPOINT_MEM top.mem.memory
+`define SIMPOINT_MEM_WORD(a) top.mem.memory[(a) >> 2]
+`define SIMPOINT_RESET_ADDR 0
+`define SIMPOINT_IRQ_PHASE top.count_cycle
+`include "simpoint.vh"
+`endif
 endmodule
 `endif
 
@@ -74,7 +89,7 @@ module picorv32_wrapper #(
 	output trace_valid,
 	output [35:0] trace_data
 );
-	wire tests_passed;
+	wire tests_passed /* verilator public */;
 	reg [31:0] irq = 0;
 
 	reg [15:0] count_cycle = 0;
@@ -108,10 +123,37 @@ module picorv32_wrapper #(
 	wire        mem_axi_rready;
 	wire [31:0] mem_axi_rdata;
 
-	// SMZ configuration (can be driven from CPU CSRs or set statically)
-	reg [31:0] smz_base = 32'h10000000;   // Secure region starts at 0x10000000
-	reg [31:0] smz_size = 32'h00010000;   // 64 KB secure region
-	reg        smz_enable = 1;             // SMZ enabled by default
+	wire [ 1:0] smz_cache_event;
+
+	// SMZ configuration of axi4_memory. These are registers rather than
+	// parameters so that one simulator build can sweep configurations: set
+	// them with +smz_base=<hex>, +smz_size=<hex>, +smz_enable=<0|1>,
+	// +smz_cipher=<n> (0 address keystream as in smz_layer, 1 key XOR as in
+	// picorv32_smz) and +smz_key=<128 bit hex>, or from testbench.cc before
+	// reset is released.
+	reg [31:0] smz_base /* verilator public */;
+	reg [31:0] smz_size /* verilator public */;
+	reg        smz_enable /* verilator public */;
+	reg [ 1:0] smz_cipher /* verilator public */;
+	reg [31:0] smz_key_0 /* verilator public */;
+	reg [31:0] smz_key_1 /* verilator public */;
+	reg [31:0] smz_key_2 /* verilator public */;
+	reg [31:0] smz_key_3 /* verilator public */;
+
+	reg [127:0] smz_key_arg;
+	initial begin
+		if (!$value$plusargs("smz_base=%h", smz_base))
+			smz_base = 32'h 1000_0000;
+		if (!$value$plusargs("smz_size=%h", smz_size))
+			smz_size = 32'h 0001_0000;
+		if (!$value$plusargs("smz_enable=%d", smz_enable))
+			smz_enable = 1;
+		if (!$value$plusargs("smz_cipher=%d", smz_cipher))
+			smz_cipher = 0;
+		if (!$value$plusargs("smz_key=%h", smz_key_arg))
+			smz_key_arg = 0;
+		{smz_key_0, smz_key_1, smz_key_2, smz_key_3} = smz_key_arg;
+	end
 
 	axi4_memory #(
 		.AXI_TEST (AXI_TEST),
@@ -144,7 +186,13 @@ module picorv32_wrapper #(
 		
 		.smz_base        (smz_base        ),
 		.smz_size        (smz_size        ),
-		.smz_enable      (smz_enable      )
+		.smz_enable      (smz_enable      ),
+		.smz_cipher      (smz_cipher      ),
+		.smz_key_0       (smz_key_0       ),
+		.smz_key_1       (smz_key_1       ),
+		.smz_key_2       (smz_key_2       ),
+		.smz_key_3       (smz_key_3       ),
+		.smz_cache_event (smz_cache_event )
 	);
 
 `ifdef RISCV_FORMAL
@@ -179,7 +227,13 @@ module picorv32_wrapper #(
 `endif
 		.ENABLE_MUL(1),
 		.ENABLE_DIV(1),
+`ifdef PCPI_CRYPTO
+		.ENABLE_CRYPTO(1),
+`endif
 		.ENABLE_IRQ(1),
+`ifdef SMZ_TRACE
+		.ENABLE_SMZ_TRACE(1),
+`endif
 		.ENABLE_TRACE(1)
 `endif
 	) uut (
@@ -224,6 +278,9 @@ module picorv32_wrapper #(
 		.rvfi_mem_wmask (rvfi_mem_wmask ),
 		.rvfi_mem_rdata (rvfi_mem_rdata ),
 		.rvfi_mem_wdata (rvfi_mem_wdata ),
+`endif
+`ifdef SMZ_TRACE
+		.smz_cache_event(smz_cache_event),
 `endif
 		.trace_valid    (trace_valid    ),
 		.trace_data     (trace_data     )
@@ -255,11 +312,68 @@ module picorv32_wrapper #(
 	);
 `endif
 
+`ifdef SMZ_TRACE
+	// ENABLE_SMZ_TRACE marks the accesses to the region of the core CSRs as
+	// secure, while mem encrypts and reports smz_cache_event for the region
+	// of +smz_base/+smz_size. Once the firmware enables its region, the two
+	// must be the same, or the records do not describe the memory traffic.
+	always @(posedge clk) begin
+		if (resetn && uut.picorv32_core.smz_enable[0] && uut.picorv32_core.mem_valid && uut.picorv32_core.mem_ready &&
+				!(smz_enable && uut.picorv32_core.smz_base == smz_base && uut.picorv32_core.smz_size == smz_size)) begin
+			$display("SMZ REGION MISMATCH: CSRs %08x+%08x, +smz_base=%08x +smz_size=%08x +smz_enable=%1d",
+					uut.picorv32_core.smz_base, uut.picorv32_core.smz_size, smz_base, smz_size, smz_enable);
+			$finish;
+		end
+	end
+`endif
+
+	// Instruction launches of the core, for the lockstep A/B mode of
+	// testbench.cc: insn_launch is set for one cycle after the core starts
+	// the instruction at insn_addr.
+`ifdef VERILATOR
+	wire        insn_launch /* verilator public */ = uut.picorv32_core.dbg_next;
+	wire [31:0] insn_addr /* verilator public */ = uut.picorv32_core.dbg_insn_addr;
+`endif
+
+`ifdef SMZ_TOGGLE
+	// picorv32_smz with and without CIPHER_GATING on the memory interface
+	// of the core, for their toggle coverage (make test_verilator_smz_toggle).
+	// They see mem_ready of the AXI adapter and drive nothing, the SMZ of the
+	// run is still the one of mem.
+	smz_toggle_pair #(.CIPHER(0)) smz_toggle_xor (
+		.clk          (clk),
+		.resetn       (resetn),
+		.cpu_mem_valid(uut.mem_valid),
+		.cpu_mem_addr (uut.mem_addr),
+		.cpu_mem_wdata(uut.mem_wdata),
+		.cpu_mem_wstrb(uut.mem_wstrb),
+		.mem_rdata    (uut.mem_rdata),
+		.mem_ready    (uut.mem_ready),
+		.smz_key      ({smz_key_0, smz_key_1, smz_key_2, smz_key_3})
+	);
+
+	smz_toggle_pair #(.CIPHER(1)) smz_toggle_arx (
+		.clk          (clk),
+		.resetn       (resetn),
+		.cpu_mem_valid(uut.mem_valid),
+		.cpu_mem_addr (uut.mem_addr),
+		.cpu_mem_wdata(uut.mem_wdata),
+		.cpu_mem_wstrb(uut.mem_wstrb),
+		.mem_rdata    (uut.mem_rdata),
+		.mem_ready    (uut.mem_ready),
+		.smz_key      ({smz_key_0, smz_key_1, smz_key_2, smz_key_3})
+	);
+`endif
+
 	reg [1023:0] firmware_file;
 	initial begin
 		if (!$value$plusargs("firmware=%s", firmware_file))
 			firmware_file = "firmware/firmware.hex";
-		$readmemh(firmware_file, mem.memory);
+		mem.load_image(firmware_file);
+`ifndef VERILATOR
+		#0;  // let the SMZ configuration reach mem
+`endif
+		mem.smz_encrypt_image;
 	end
 
 	integer cycle_counter;
@@ -270,6 +384,9 @@ module picorv32_wrapper #(
 			repeat (10) @(posedge clk);
 `endif
 			$display("TRAP after %1d clock cycles", cycle_counter);
+			if (mem.smz_cache_lines)
+				$display("SMZ keystream cache: %1d hits, %1d misses", mem.smz_cache_hits, mem.smz_cache_misses);
+			mem.hist_dump;
 			if (tests_passed) begin
 				$display("ALL TESTS PASSED.");
 				$finish;
@@ -283,6 +400,57 @@ module picorv32_wrapper #(
 	end
 endmodule
 
+`ifdef SMZ_TOGGLE
+module smz_toggle_pair #(
+	parameter integer CIPHER = 0
+) (
+	input         clk,
+	input         resetn,
+	input         cpu_mem_valid,
+	input  [31:0] cpu_mem_addr,
+	input  [31:0] cpu_mem_wdata,
+	input  [ 3:0] cpu_mem_wstrb,
+	input  [31:0] mem_rdata,
+	input         mem_ready,
+	input [127:0] smz_key
+);
+	// pair[0] without CIPHER_GATING, pair[1] with it; the region defaults
+	// are those of picorv32_wrapper, +smz_* with SMZ_RUNTIME_CONFIG
+	genvar i;
+	generate for (i = 0; i < 2; i = i + 1) begin : pair
+		picorv32_smz #(
+			.SECURE_REGION_BASE(32'h 1000_0000),
+			.SECURE_REGION_SIZE(32'h 0001_0000),
+			.CIPHER            (CIPHER),
+			.CIPHER_GATING     (i)
+		) smz (
+			.clk          (clk          ),
+			.resetn       (resetn       ),
+			.clk2x        (1'b0         ),
+			.cpu_mem_valid(cpu_mem_valid),
+			.cpu_mem_addr (cpu_mem_addr ),
+			.cpu_mem_wdata(cpu_mem_wdata),
+			.cpu_mem_wstrb(cpu_mem_wstrb),
+			.cpu_mem_rdata(             ),
+			.cpu_mem_ready(             ),
+			.mem_valid    (             ),
+			.mem_addr     (             ),
+			.mem_wdata    (             ),
+			.mem_wstrb    (             ),
+			.mem_rdata    (mem_rdata    ),
+			.mem_ready    (mem_ready    ),
+			.mem_ecc_wdata(             ),
+			.mem_ecc_rdata(7'b0         ),
+			.ecc_event    (             ),
+			.smz_key_0    (smz_key[127:96]),
+			.smz_key_1    (smz_key[ 95:64]),
+			.smz_key_2    (smz_key[ 63:32]),
+			.smz_key_3    (smz_key[ 31: 0])
+		);
+	end endgenerate
+endmodule
+`endif
+
 module axi4_memory #(
 	parameter AXI_TEST = 0,
 	parameter VERBOSE = 0
@@ -317,9 +485,48 @@ module axi4_memory #(
 	// SMZ configuration inputs (from CPU CSRs)
 	input      [31:0] smz_base,
 	input      [31:0] smz_size,
-	input             smz_enable
+	input             smz_enable,
+	input      [ 1:0] smz_cipher,
+	input      [31:0] smz_key_0,
+	input      [31:0] smz_key_1,
+	input      [31:0] smz_key_2,
+	input      [31:0] smz_key_3,
+
+	// keystream cache result of the current response, {miss, hit}
+	output reg [ 1:0] smz_cache_event
 );
-	reg [31:0]   memory [0:128*1024/4-1] /* verilator public */;
+`ifdef VERILATOR
+	// In Verilator builds the memory is a copy-on-write mapping of the
+	// firmware image in testbench_mem.cc, see testbench_mem.h.
+	import "DPI-C" function int tb_dpi_mem_load(input string file);
+	import "DPI-C" function int tb_dpi_mem_read(input int index);
+	import "DPI-C" function void tb_dpi_mem_write(input int index, input int data, input int wstrb);
+`else
+	reg [31:0]   memory [0:128*1024/4-1];
+`endif
+
+	task load_image;
+		input [1023:0] file;
+		begin
+`ifdef VERILATOR
+			if (tb_dpi_mem_load($sformatf("%0s", file)) == 0)
+				$finish;
+`else
+			$readmemh(file, memory);
+`endif
+		end
+	endtask
+
+	function [31:0] mem_read;
+		input [31:0] index;
+		begin
+`ifdef VERILATOR
+			mem_read = tb_dpi_mem_read(index);
+`else
+			mem_read = memory[index];
+`endif
+		end
+	endfunction
 	reg verbose;
 	initial verbose = $test$plusargs("verbose") || VERBOSE;
 
@@ -333,6 +540,7 @@ module axi4_memory #(
 		mem_axi_arready = 0;
 		mem_axi_rvalid = 0;
 		tests_passed = 0;
+		smz_cache_event = 0;
 	end
 
 	reg [63:0] xorshift64_state = 64'd88172645463325252;
@@ -394,33 +602,271 @@ module axi4_memory #(
 		fast_wdata <= 1;
 	end endtask
 
-	// Helper: compute encryption keystream
+	// Helper: compute encryption keystream (see scripts/libsmz for the modes)
 	function [31:0] get_keystream;
 		input [31:0] addr;
-		get_keystream = addr ^ 32'hDEADBEEF;
+		case (smz_cipher)
+			1: get_keystream = smz_key_0 ^ smz_key_1 ^ smz_key_2 ^ smz_key_3;
+			default: get_keystream = addr ^ 32'hDEADBEEF;
+		endcase
+	endfunction
+
+	// SMZ keystream cache timing model. With +smz_latency=<n> an access to
+	// the secure region waits <n> cycles for its keystream, unless the line
+	// is in a direct mapped cache of +smz_cache_lines=<n> 16 byte lines (a
+	// power of two, at most 256). Both default to 0, i.e. no extra latency.
+	// The settings and tags are public so that testbench.cc can change them
+	// and warm the cache.
+	integer smz_latency /* verilator public */;
+	integer smz_cache_lines /* verilator public */;
+	integer smz_cache_hits /* verilator public */;
+	integer smz_cache_misses /* verilator public */;
+	reg [31:0] smz_cache_tag [0:255] /* verilator public */;
+
+	integer smz_rwait = 0;
+	integer smz_wwait = 0;
+	reg smz_rchecked = 0;
+	reg smz_wchecked = 0;
+	reg [1:0] smz_revent = 0;
+	reg [1:0] smz_wevent = 0;
+
+	integer smz_i;
+	initial begin
+		if (!$value$plusargs("smz_latency=%d", smz_latency))
+			smz_latency = 0;
+		if (!$value$plusargs("smz_cache_lines=%d", smz_cache_lines))
+			smz_cache_lines = 0;
+		smz_cache_hits = 0;
+		smz_cache_misses = 0;
+		for (smz_i = 0; smz_i < 256; smz_i = smz_i + 1)
+			smz_cache_tag[smz_i] = 0;
+	end
+
+	task smz_lookup;
+		input [31:0] addr;
+		output integer wait_cycles;
+		output [1:0] cache_event;
+		reg [7:0] idx;
+		begin
+			wait_cycles = 0;
+			cache_event = 0;
+			if (smz_enable && (addr >= smz_base) && (addr < (smz_base + smz_size))) begin
+				if (smz_cache_lines) begin
+					idx = (addr >> 4) & (smz_cache_lines - 1);
+					if (smz_cache_tag[idx] == {addr[31:4], 4'b0001}) begin
+						smz_cache_hits = smz_cache_hits + 1;
+						cache_event = 2'b01;
+					end else begin
+						smz_cache_misses = smz_cache_misses + 1;
+						cache_event = 2'b10;
+						smz_cache_tag[idx] = {addr[31:4], 4'b0001};
+						wait_cycles = smz_latency;
+					end
+				end else
+					wait_cycles = smz_latency;
+			end
+		end
+	endtask
+
+	// Traffic statistics, always on. The latency of an access is counted
+	// from arvalid/awvalid to the rvalid/bvalid handshake and binned per
+	// region (0 non-secure, 1 secure, 2 MMIO) and direction (0 read, 1 write),
+	// the last bin holding all accesses of 16 or more cycles. Bytes are summed
+	// per +hist_window=<n> cycles (default 1024) and each window is binned by
+	// the log2 of its byte count per region. hist_dump prints it all at the
+	// end of the run and whenever the firmware writes to 0x2000_0004;
+	// +nohist turns the report off.
+	localparam HIST_LAT_BINS = 17;
+	localparam HIST_BW_BINS = 20;
+
+	reg hist_enable;
+	integer hist_window = 1024;
+	integer hist_cycle = 0;
+	integer hist_window_left = 1024;
+	integer hist_windows = 0;
+	integer hist_rstart = 0;
+	integer hist_wstart = 0;
+	reg hist_rbusy = 0;
+	reg hist_wbusy = 0;
+	integer hist_latency [0:6*HIST_LAT_BINS-1];
+	integer hist_count [0:5];
+	integer hist_bytes [0:5];
+	integer hist_window_bytes [0:2];
+	integer hist_bandwidth [0:3*HIST_BW_BINS-1];
+
+	integer hist_i;
+	initial begin
+		hist_enable = !$test$plusargs("nohist");
+		if (!$value$plusargs("hist_window=%d", hist_window) || hist_window < 1)
+			hist_window = 1024;
+		hist_window_left = hist_window;
+		for (hist_i = 0; hist_i < 6*HIST_LAT_BINS; hist_i = hist_i + 1)
+			hist_latency[hist_i] = 0;
+		for (hist_i = 0; hist_i < 6; hist_i = hist_i + 1) begin
+			hist_count[hist_i] = 0;
+			hist_bytes[hist_i] = 0;
+		end
+		for (hist_i = 0; hist_i < 3; hist_i = hist_i + 1)
+			hist_window_bytes[hist_i] = 0;
+		for (hist_i = 0; hist_i < 3*HIST_BW_BINS; hist_i = hist_i + 1)
+			hist_bandwidth[hist_i] = 0;
+	end
+
+	function [1:0] hist_region;
+		input [31:0] addr;
+		begin
+			if (addr >= 128*1024)
+				hist_region = 2;
+			else if (smz_enable && (addr >= smz_base) && (addr < (smz_base + smz_size)))
+				hist_region = 1;
+			else
+				hist_region = 0;
+		end
 	endfunction
 
+	task hist_access;
+		input [1:0] region;
+		input write;
+		input integer latency;
+		input integer bytes;
+		integer idx;
+		begin
+			idx = 2*region + write;
+			hist_count[idx] = hist_count[idx] + 1;
+			hist_bytes[idx] = hist_bytes[idx] + bytes;
+			hist_window_bytes[region] = hist_window_bytes[region] + bytes;
+			if (latency > HIST_LAT_BINS-1)
+				latency = HIST_LAT_BINS-1;
+			hist_latency[idx*HIST_LAT_BINS + latency] = hist_latency[idx*HIST_LAT_BINS + latency] + 1;
+		end
+	endtask
+
+	task hist_tick;
+		integer r, b, k;
+		begin
+			hist_cycle = hist_cycle + 1;
+			hist_window_left = hist_window_left - 1;
+			if (!hist_window_left) begin
+				for (r = 0; r < 3; r = r + 1) begin
+					k = 0;
+					for (b = hist_window_bytes[r]; b && k < HIST_BW_BINS-1; b = b >> 1)
+						k = k + 1;
+					hist_bandwidth[r*HIST_BW_BINS + k] = hist_bandwidth[r*HIST_BW_BINS + k] + 1;
+					hist_window_bytes[r] = 0;
+				end
+				hist_windows = hist_windows + 1;
+				hist_window_left = hist_window;
+			end
+		end
+	endtask
+
+	task hist_dump;
+		integer r, d, i, total;
+		begin
+			if (hist_enable) begin
+				$display("MEMORY TRAFFIC after %1d cycles, %1d windows of %1d cycles:", hist_cycle, hist_windows, hist_window);
+				for (r = 0; r < 3; r = r + 1) begin
+					total = hist_count[2*r] + hist_count[2*r+1];
+					case (r)
+						0: $write("  non-secure");
+						1: $write("  secure    ");
+						default: $write("  mmio      ");
+					endcase
+					$display(" %1d reads (%1d bytes), %1d writes (%1d bytes), %1d%% reads", hist_count[2*r], hist_bytes[2*r],
+							hist_count[2*r+1], hist_bytes[2*r+1], total ? 100*hist_count[2*r] / total : 0);
+					for (d = 0; d < 2; d = d + 1) begin
+						if (d)
+							$write("    write latency 0..%1d+:", HIST_LAT_BINS-1);
+						else
+							$write("    read latency 0..%1d+: ", HIST_LAT_BINS-1);
+						for (i = 0; i < HIST_LAT_BINS; i = i + 1)
+							$write(" %1d", hist_latency[(2*r+d)*HIST_LAT_BINS + i]);
+						$display("");
+					end
+					$write("    bytes/window 0,1,2..3,..:");
+					for (i = 0; i < HIST_BW_BINS; i = i + 1)
+						$write(" %1d", hist_bandwidth[r*HIST_BW_BINS + i]);
+					$display("");
+				end
+			end
+		end
+	endtask
+
+`ifdef VERILATOR
+	// C++ device models above the 128 KB of memory (see testbench_dev.h)
+	import "DPI-C" function int tb_dpi_dev_match(input int addr);
+	import "DPI-C" function int tb_dpi_dev_read(input int addr);
+	import "DPI-C" function void tb_dpi_dev_write(input int addr, input int data, input int wstrb);
+	import "DPI-C" function int tb_dpi_dev_ticks();
+	import "DPI-C" function void tb_dpi_dev_tick();
+
+	reg dev_ticks;
+	initial dev_ticks = tb_dpi_dev_ticks() != 0;
+	always @(posedge clk) if (dev_ticks) tb_dpi_dev_tick();
+`endif
+
+	// encrypt the plaintext firmware image for the secure region, called by
+	// picorv32_wrapper after $readmemh
+	task smz_encrypt_image;
+		reg [31:0] addr;
+		integer i;
+		begin
+			for (i = 0; i < 128*1024/4; i = i + 1) begin
+				addr = 4*i;
+				if (smz_enable && (addr >= smz_base) && (addr < (smz_base + smz_size)))
+`ifdef VERILATOR
+					tb_dpi_mem_write(i, mem_read(i) ^ get_keystream(addr), 15);
+`else
+					memory[i] = memory[i] ^ get_keystream(addr);
+`endif
+			end
+		end
+	endtask
+
+	task smz_check; begin
+		if (latched_raddr_en && !smz_rchecked) begin
+			smz_lookup(latched_raddr, smz_rwait, smz_revent);
+			smz_rchecked = 1;
+		end
+		if (latched_waddr_en && !smz_wchecked) begin
+			smz_lookup(latched_waddr, smz_wwait, smz_wevent);
+			smz_wchecked = 1;
+		end
+	end endtask
+
 	task handle_axi_rvalid; begin
 		reg [31:0] read_data;
 		reg [31:0] keystream;
 		reg is_secure;
+		reg is_dev;
 		
-		read_data = memory[latched_raddr >> 2];
+		read_data = mem_read(latched_raddr >> 2);
 		is_secure = smz_enable && (latched_raddr >= smz_base) && (latched_raddr < (smz_base + smz_size));
 		
 		if (is_secure) begin
 			keystream = get_keystream(latched_raddr);
 			read_data = read_data ^ keystream;  // Decrypt
 		end
+
+		is_dev = 0;
+`ifdef VERILATOR
+		if (latched_raddr >= 128*1024 && tb_dpi_dev_match(latched_raddr) != 0) begin
+			read_data = tb_dpi_dev_read(latched_raddr);
+			is_dev = 1;
+		end
+`endif
 		
 		if (verbose)
 			$display("RD: ADDR=%08x DATA=%08x%s", latched_raddr, read_data, latched_rinsn ? " INSN" : "");
-		if (latched_raddr < 128*1024) begin
+		if (latched_raddr < 128*1024 || is_dev) begin
 			mem_axi_rdata <= read_data;
 			mem_axi_rvalid <= 1;
+			smz_cache_event <= smz_revent;
 			latched_raddr_en = 0;
+			smz_rchecked = 0;
 		end else begin
 			$display("OUT-OF-BOUNDS MEMORY READ FROM %08x", latched_raddr);
+			hist_dump;
 			$finish;
 		end
 	end endtask
@@ -441,10 +887,14 @@ module axi4_memory #(
 		if (verbose)
 			$display("WR: ADDR=%08x DATA=%08x STRB=%04b", latched_waddr, encrypted_data, latched_wstrb);
 		if (latched_waddr < 128*1024) begin
+`ifdef VERILATOR
+			tb_dpi_mem_write(latched_waddr >> 2, encrypted_data, {28'b0, latched_wstrb});
+`else
 			if (latched_wstrb[0]) memory[latched_waddr >> 2][ 7: 0] <= encrypted_data[ 7: 0];
 			if (latched_wstrb[1]) memory[latched_waddr >> 2][15: 8] <= encrypted_data[15: 8];
 			if (latched_wstrb[2]) memory[latched_waddr >> 2][23:16] <= encrypted_data[23:16];
 			if (latched_wstrb[3]) memory[latched_waddr >> 2][31:24] <= encrypted_data[31:24];
+`endif
 		end else
 		if (latched_waddr == 32'h1000_0000) begin
 			if (verbose) begin
@@ -462,21 +912,34 @@ module axi4_memory #(
 		if (latched_waddr == 32'h2000_0000) begin
 			if (latched_wdata == 123456789)
 				tests_passed = 1;
-		end else begin
+		end else
+		if (latched_waddr == 32'h2000_0004) begin
+			hist_dump;
+		end else
+`ifdef VERILATOR
+		if (tb_dpi_dev_match(latched_waddr) != 0) begin
+			tb_dpi_dev_write(latched_waddr, latched_wdata, {28'b0, latched_wstrb});
+		end else
+`endif
+		begin
 			$display("OUT-OF-BOUNDS MEMORY WRITE TO %08x", latched_waddr);
+			hist_dump;
 			$finish;
 		end
 		mem_axi_bvalid <= 1;
+		smz_cache_event <= smz_wevent;
 		latched_waddr_en = 0;
 		latched_wdata_en = 0;
+		smz_wchecked = 0;
 	end endtask
 
 	always @(negedge clk) begin
 		if (mem_axi_arvalid && !(latched_raddr_en || fast_raddr) && async_axi_transaction[0]) handle_axi_arvalid;
 		if (mem_axi_awvalid && !(latched_waddr_en || fast_waddr) && async_axi_transaction[1]) handle_axi_awvalid;
 		if (mem_axi_wvalid  && !(latched_wdata_en || fast_wdata) && async_axi_transaction[2]) handle_axi_wvalid;
-		if (!mem_axi_rvalid && latched_raddr_en && async_axi_transaction[3]) handle_axi_rvalid;
-		if (!mem_axi_bvalid && latched_waddr_en && latched_wdata_en && async_axi_transaction[4]) handle_axi_bvalid;
+		smz_check;
+		if (!mem_axi_rvalid && latched_raddr_en && !smz_rwait && async_axi_transaction[3]) handle_axi_rvalid;
+		if (!mem_axi_bvalid && latched_waddr_en && latched_wdata_en && !smz_wwait && async_axi_transaction[4]) handle_axi_bvalid;
 	end
 
 	always @(posedge clk) begin
@@ -488,6 +951,28 @@ module axi4_memory #(
 		fast_waddr <= 0;
 		fast_wdata <= 0;
 
+		if (smz_rwait) smz_rwait = smz_rwait - 1;
+		if (smz_wwait) smz_wwait = smz_wwait - 1;
+
+		hist_tick;
+		if (mem_axi_rvalid && mem_axi_rready) begin
+			hist_access(hist_region(latched_raddr), 0, hist_cycle - hist_rstart, 4);
+			hist_rbusy = 0;
+		end
+		if (mem_axi_bvalid && mem_axi_bready) begin
+			hist_access(hist_region(latched_waddr), 1, hist_cycle - hist_wstart,
+					(latched_wstrb[0] ? 1 : 0) + (latched_wstrb[1] ? 1 : 0) + (latched_wstrb[2] ? 1 : 0) + (latched_wstrb[3] ? 1 : 0));
+			hist_wbusy = 0;
+		end
+		if (mem_axi_arvalid && !hist_rbusy) begin
+			hist_rstart = hist_cycle;
+			hist_rbusy = 1;
+		end
+		if ((mem_axi_awvalid || mem_axi_wvalid) && !hist_wbusy) begin
+			hist_wstart = hist_cycle;
+			hist_wbusy = 1;
+		end
+
 		if (mem_axi_rvalid && mem_axi_rready) begin
 			mem_axi_rvalid <= 0;
 		end
@@ -517,7 +1002,8 @@ module axi4_memory #(
 		if (mem_axi_awvalid && !(latched_waddr_en || fast_waddr) && !delay_axi_transaction[1]) handle_axi_awvalid;
 		if (mem_axi_wvalid  && !(latched_wdata_en || fast_wdata) && !delay_axi_transaction[2]) handle_axi_wvalid;
 
-		if (!mem_axi_rvalid && latched_raddr_en && !delay_axi_transaction[3]) handle_axi_rvalid;
-		if (!mem_axi_bvalid && latched_waddr_en && latched_wdata_en && !delay_axi_transaction[4]) handle_axi_bvalid;
+		smz_check;
+		if (!mem_axi_rvalid && latched_raddr_en && !smz_rwait && !delay_axi_transaction[3]) handle_axi_rvalid;
+		if (!mem_axi_bvalid && latched_waddr_en && latched_wdata_en && !smz_wwait && !delay_axi_transaction[4]) handle_axi_bvalid;
 	end
 endmodule
@@ -0,0 +1,231 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "testbench_dev.h"
+#include "scripts/libsmz/libsmz.h"
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+
+// same as axi4_memory in testbench.v
+#define MEM_SIZE (128*1024)
+
+struct tb_dev_entry {
+	const char *name;
+	uint32_t base, size;
+	tb_device *dev;
+};
+
+struct tb_dev_bank {
+	std::vector<tb_dev_entry> devices;
+	std::vector<tb_device*> tick_devices;
+	// the built-in devices of tb_dev_builtin(), owned by the bank
+	std::vector<std::unique_ptr<tb_device>> builtins;
+	// the last device hit, accesses tend to repeat
+	const tb_dev_entry *last_hit = NULL;
+};
+
+static tb_dev_bank banks[TB_DEV_BANKS];
+static tb_dev_bank *bank = &banks[0];
+
+void tb_dev_select(int b)
+{
+	bank = &banks[b];
+}
+
+static const tb_dev_entry *tb_dev_find(uint32_t addr)
+{
+	const tb_dev_entry *last_hit = bank->last_hit;
+	if (last_hit && addr - last_hit->base < last_hit->size)
+		return last_hit;
+	for (auto &d : bank->devices)
+		if (addr - d.base < d.size)
+			return bank->last_hit = &d;
+	return NULL;
+}
+
+bool tb_dev_register(const char *name, uint32_t base, uint32_t size, tb_device *dev, bool ticks)
+{
+	uint64_t end = (uint64_t)base + size;
+	if (!size || end > (1ULL << 32) || base < MEM_SIZE)
+		return false;
+	for (auto &d : bank->devices)
+		if (base < (uint64_t)d.base + d.size && d.base < end)
+			return false;
+	bank->devices.push_back({ name, base, size, dev });
+	bank->last_hit = NULL;
+	if (ticks)
+		bank->tick_devices.push_back(dev);
+	return true;
+}
+
+bool tb_dev_read(uint32_t addr, uint32_t &data)
+{
+	const tb_dev_entry *d = tb_dev_find(addr & ~3);
+	if (!d)
+		return false;
+	data = d->dev->read((addr & ~3) - d->base);
+	return true;
+}
+
+bool tb_dev_write(uint32_t addr, uint32_t data, uint32_t wstrb)
+{
+	const tb_dev_entry *d = tb_dev_find(addr & ~3);
+	if (!d)
+		return false;
+	d->dev->write((addr & ~3) - d->base, data, wstrb);
+	return true;
+}
+
+void tb_dev_tick(uint64_t cycles)
+{
+	for (auto dev : bank->tick_devices)
+		dev->tick(cycles);
+}
+
+// DPI functions imported by axi4_memory (testbench.v)
+
+extern "C" int tb_dpi_dev_match(int addr)
+{
+	return tb_dev_find((uint32_t)addr & ~3) != NULL;
+}
+
+extern "C" int tb_dpi_dev_read(int addr)
+{
+	uint32_t data = 0;
+	tb_dev_read(addr, data);
+	return data;
+}
+
+extern "C" void tb_dpi_dev_write(int addr, int data, int wstrb)
+{
+	tb_dev_write(addr, data, wstrb);
+}
+
+extern "C" int tb_dpi_dev_ticks()
+{
+	return !bank->tick_devices.empty();
+}
+
+extern "C" void tb_dpi_dev_tick()
+{
+	tb_dev_tick(1);
+}
+
+// Built-in devices
+
+static uint32_t merge(uint32_t old, uint32_t data, uint32_t wstrb)
+{
+	uint32_t mask = 0;
+	for (int i = 0; i < 4; i++)
+		if (wstrb & (1 << i))
+			mask |= 0xffu << (8 * i);
+	return (old & ~mask) | (data & mask);
+}
+
+struct tb_dev_timer : tb_device
+{
+	uint64_t count = 0;
+	uint32_t compare = 0;
+	bool status = false;
+
+	uint32_t read(uint32_t offset) override
+	{
+		switch (offset) {
+		case 0:  return count;
+		case 4:  return count >> 32;
+		case 8:  return compare;
+		case 12: return status;
+		}
+		return 0;
+	}
+
+	void write(uint32_t offset, uint32_t data, uint32_t wstrb) override
+	{
+		switch (offset) {
+		case 0:
+		case 4:  count = 0; break;
+		case 8:  compare = merge(compare, data, wstrb); break;
+		case 12: if (data & 1) status = false; break;
+		}
+	}
+
+	void tick(uint64_t cycles) override
+	{
+		if (compare && count < compare && count + cycles >= compare)
+			status = true;
+		count += cycles;
+	}
+};
+
+struct tb_dev_rng : tb_device
+{
+	uint64_t state = 88172645463325252ULL;
+
+	uint32_t read(uint32_t) override
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return state;
+	}
+
+	void write(uint32_t, uint32_t data, uint32_t) override
+	{
+		state = data ? data : 88172645463325252ULL;
+	}
+};
+
+struct tb_dev_smz : tb_device
+{
+	smz_cipher cipher = { SMZ_MODE_ADDR, { 0, 0, 0, 0 }, 0 };
+	uint32_t addr = 0, result = 0;
+
+	uint32_t read(uint32_t offset) override
+	{
+		switch (offset) {
+		case 0:  return addr;
+		case 8:  return result;
+		case 12: return cipher.mode;
+		}
+		if (offset >= 16 && offset < 32)
+			return cipher.key[(offset - 16) / 4];
+		return 0;
+	}
+
+	void write(uint32_t offset, uint32_t data, uint32_t wstrb) override
+	{
+		switch (offset) {
+		case 0:  addr = merge(addr, data, wstrb); return;
+		case 4:  result = data ^ smz_keystream(cipher, addr); return;
+		case 12: cipher.mode = (smz_mode)(data % (SMZ_MODE_TRIVIUM + 1)); return;
+		}
+		if (offset >= 16 && offset < 32)
+			cipher.key[(offset - 16) / 4] = merge(cipher.key[(offset - 16) / 4], data, wstrb);
+	}
+};
+
+static bool tb_dev_register_builtin(const char *name, uint32_t base, uint32_t size, tb_device *dev, bool ticks = false)
+{
+	std::unique_ptr<tb_device> owned(dev);
+	if (!tb_dev_register(name, base, size, dev, ticks))
+		return false;
+	bank->builtins.push_back(std::move(owned));
+	return true;
+}
+
+bool tb_dev_builtin(const char *kind, uint32_t base)
+{
+	if (!strcmp(kind, "timer"))
+		return tb_dev_register_builtin("timer", base, 16, new tb_dev_timer, true);
+	if (!strcmp(kind, "rng"))
+		return tb_dev_register_builtin("rng", base, 4, new tb_dev_rng);
+	if (!strcmp(kind, "smz"))
+		return tb_dev_register_builtin("smz", base, 32, new tb_dev_smz);
+	return false;
+}
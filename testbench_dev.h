@@ -0,0 +1,65 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// C++ models of memory-mapped devices for the Verilator testbench. A device
+// registered with tb_dev_register() serves the word accesses to its address
+// range above the 128 KB of axi4_memory: axi4_memory calls it through DPI
+// (testbench.v) and the functional ISS (testbench_iss.cc) calls it directly,
+// so device state carries over a +iss handoff. The fixed addresses of
+// axi4_memory (console at 0x1000_0000, 0x2000_0000/4) take precedence.
+//
+// Devices that register with ticks get tick(n) for every n elapsed cycles:
+// once per clock in the RTL, the estimated cycles per instruction in the
+// ISS. Devices must be registered before the first eval of the model.
+//
+// The devices are per bank: model instances in the same process (the A/B
+// lockstep) select their bank with tb_dev_select() and register their own
+// device instances in it.
+
+#ifndef TESTBENCH_DEV_H
+#define TESTBENCH_DEV_H
+
+#include <stdint.h>
+
+#define TB_DEV_BANKS 2
+
+struct tb_device
+{
+	virtual ~tb_device() { }
+
+	// offset is the byte offset of the word in the device range, wstrb the
+	// byte enables of the write as on AXI
+	virtual uint32_t read(uint32_t offset) = 0;
+	virtual void write(uint32_t offset, uint32_t data, uint32_t wstrb) = 0;
+	virtual void tick(uint64_t cycles) { (void)cycles; }
+};
+
+// Select the bank for the registrations, accesses and ticks that follow.
+void tb_dev_select(int bank);
+
+// The device is owned by the caller and registered in the selected bank.
+// Returns false if the range is empty, overlaps axi4_memory or another
+// device.
+bool tb_dev_register(const char *name, uint32_t base, uint32_t size, tb_device *dev, bool ticks = false);
+
+bool tb_dev_read(uint32_t addr, uint32_t &data);
+bool tb_dev_write(uint32_t addr, uint32_t data, uint32_t wstrb);
+void tb_dev_tick(uint64_t cycles);
+
+// Built-in devices, registered by testbench.cc for +dev_<kind>=<hex base>:
+//
+//   timer  0 cycle count low, 4 high (write clears), 8 compare,
+//          12 status (bit 0 count >= compare, write 1 to clear)
+//   rng    0 next 32 bit xorshift64 value, write seeds the generator
+//   smz    0 address, 4 data (write runs the cipher), 8 result,
+//          12 cipher, 16..28 key_0..key_3; the SMZ ciphers of scripts/libsmz
+//
+// The device is owned by the selected bank and freed with it. Returns false
+// for an unknown kind or a range tb_dev_register() rejects.
+bool tb_dev_builtin(const char *kind, uint32_t base);
+
+#endif
@@ -0,0 +1,567 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "testbench_iss.h"
+#include "testbench_dev.h"
+#include <stdio.h>
+#include <string.h>
+
+// same settings as picorv32_wrapper and axi4_memory in testbench.v
+#define PROGADDR_RESET 0x00000000
+#define PROGADDR_IRQ   0x00000010
+#define MEM_SIZE       (128*1024)
+
+enum { irq_timer = 0, irq_ebreak = 1, irq_buserror = 2 };
+
+static inline uint32_t sext(uint32_t v, int bits)
+{
+	return (uint32_t)((int32_t)(v << (32 - bits)) >> (32 - bits));
+}
+
+static inline uint32_t bits(uint32_t v, int hi, int lo)
+{
+	return (v >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+// picorv32_pcpi_crypto (ENABLE_CRYPTO)
+
+static uint8_t aes_sbox[256], aes_inv_sbox[256];
+
+static inline uint32_t ror32(uint32_t x, int n)
+{
+	return (x >> n) | (x << ((32 - n) & 31));
+}
+
+static inline uint8_t xtime(uint8_t x)
+{
+	return (x << 1) ^ (x & 0x80 ? 0x1b : 0);
+}
+
+static void aes_init()
+{
+	if (aes_sbox[0])
+		return;
+	for (int x = 0; x < 256; x++) {
+		// inverse in GF(2^8) by exhaustive search, then the affine map
+		uint8_t inv = 0;
+		for (int y = 1; y < 256 && x; y++) {
+			uint8_t a = x, b = y, p = 0;
+			for (; b; b >>= 1, a = xtime(a))
+				if (b & 1)
+					p ^= a;
+			if (p == 1) {
+				inv = y;
+				break;
+			}
+		}
+		uint8_t s = inv ^ 0x63;
+		for (int i = 1; i <= 4; i++)
+			s ^= (uint8_t)(inv << i | inv >> (8 - i));
+		aes_sbox[x] = s;
+		aes_inv_sbox[s] = x;
+	}
+}
+
+static uint32_t aes32(uint32_t rs1, uint32_t rs2, int bs, bool dec, bool mix)
+{
+	uint8_t so = dec ? aes_inv_sbox[(rs2 >> 8*bs) & 0xff] : aes_sbox[(rs2 >> 8*bs) & 0xff];
+	uint8_t x2 = xtime(so), x4 = xtime(x2), x8 = xtime(x4);
+	uint32_t mixed = so;
+	if (mix && !dec)
+		mixed = (uint32_t)(x2 ^ so) << 24 | so << 16 | so << 8 | x2;
+	else if (mix)
+		mixed = (uint32_t)(x8 ^ x2 ^ so) << 24 | (x8 ^ x4 ^ so) << 16 | (x8 ^ so) << 8 | (x8 ^ x4 ^ x2);
+	return rs1 ^ ror32(mixed, (32 - 8*bs) & 31);
+}
+
+static uint64_t clmul64(uint32_t a, uint32_t b)
+{
+	uint64_t r = 0;
+	for (int i = 0; i < 32; i++)
+		if (b >> i & 1)
+			r ^= (uint64_t)a << i;
+	return r;
+}
+
+// instruction encoders, used to expand RVC instructions
+
+static uint32_t enc_r(int f7, int rs2, int rs1, int f3, int rd, int op)
+{
+	return f7 << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+}
+
+static uint32_t enc_i(uint32_t imm, int rs1, int f3, int rd, int op)
+{
+	return (imm & 0xfff) << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op;
+}
+
+static uint32_t enc_s(uint32_t imm, int rs2, int rs1, int f3)
+{
+	return bits(imm, 11, 5) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | bits(imm, 4, 0) << 7 | 0x23;
+}
+
+static uint32_t enc_b(uint32_t imm, int rs2, int rs1, int f3)
+{
+	return bits(imm, 12, 12) << 31 | bits(imm, 10, 5) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 |
+			bits(imm, 4, 1) << 8 | bits(imm, 11, 11) << 7 | 0x63;
+}
+
+static uint32_t enc_j(uint32_t imm, int rd)
+{
+	return bits(imm, 20, 20) << 31 | bits(imm, 10, 1) << 21 | bits(imm, 11, 11) << 20 |
+			bits(imm, 19, 12) << 12 | rd << 7 | 0x6f;
+}
+
+// returns the equivalent 32 bit instruction, or 0 (illegal)
+static uint32_t expand_compressed(uint32_t c)
+{
+	int rd = bits(c, 11, 7), rs2 = bits(c, 6, 2);
+	int rdp = 8 + bits(c, 4, 2), rs1p = 8 + bits(c, 9, 7);
+	uint32_t imm;
+
+	switch (bits(c, 1, 0) << 3 | bits(c, 15, 13))
+	{
+	case 000: // c.addi4spn
+		imm = bits(c, 12, 11) << 4 | bits(c, 10, 7) << 6 | bits(c, 6, 6) << 2 | bits(c, 5, 5) << 3;
+		return imm ? enc_i(imm, 2, 0, rdp, 0x13) : 0;
+	case 002: // c.lw
+		imm = bits(c, 12, 10) << 3 | bits(c, 6, 6) << 2 | bits(c, 5, 5) << 6;
+		return enc_i(imm, rs1p, 2, rdp, 0x03);
+	case 006: // c.sw
+		imm = bits(c, 12, 10) << 3 | bits(c, 6, 6) << 2 | bits(c, 5, 5) << 6;
+		return enc_s(imm, rdp, rs1p, 2);
+	case 010: // c.addi
+		return enc_i(sext(bits(c, 12, 12) << 5 | rs2, 6), rd, 0, rd, 0x13);
+	case 011: // c.jal
+	case 015: // c.j
+		imm = bits(c, 12, 12) << 11 | bits(c, 11, 11) << 4 | bits(c, 10, 9) << 8 | bits(c, 8, 8) << 10 |
+				bits(c, 7, 7) << 6 | bits(c, 6, 6) << 7 | bits(c, 5, 3) << 1 | bits(c, 2, 2) << 5;
+		return enc_j(sext(imm, 12), bits(c, 15, 13) == 1 ? 1 : 0);
+	case 012: // c.li
+		return enc_i(sext(bits(c, 12, 12) << 5 | rs2, 6), 0, 0, rd, 0x13);
+	case 013:
+		if (rd == 2) { // c.addi16sp
+			imm = bits(c, 12, 12) << 9 | bits(c, 6, 6) << 4 | bits(c, 5, 5) << 6 |
+					bits(c, 4, 3) << 7 | bits(c, 2, 2) << 5;
+			return imm ? enc_i(sext(imm, 10), 2, 0, 2, 0x13) : 0;
+		}
+		imm = sext(bits(c, 12, 12) << 17 | rs2 << 12, 18); // c.lui
+		return imm ? (imm & 0xfffff000) | rd << 7 | 0x37 : 0;
+	case 014:
+		imm = bits(c, 12, 12) << 5 | rs2;
+		switch (bits(c, 11, 10)) {
+		case 0: return enc_i(imm, rs1p, 5, rs1p, 0x13);               // c.srli
+		case 1: return enc_i(imm | 0x400, rs1p, 5, rs1p, 0x13);       // c.srai
+		case 2: return enc_i(sext(imm, 6), rs1p, 7, rs1p, 0x13);      // c.andi
+		}
+		if (bits(c, 12, 12))
+			return 0;
+		switch (bits(c, 6, 5)) {
+		case 0: return enc_r(0x20, rdp, rs1p, 0, rs1p, 0x33);         // c.sub
+		case 1: return enc_r(0, rdp, rs1p, 4, rs1p, 0x33);            // c.xor
+		case 2: return enc_r(0, rdp, rs1p, 6, rs1p, 0x33);            // c.or
+		}
+		return enc_r(0, rdp, rs1p, 7, rs1p, 0x33);                    // c.and
+	case 016: // c.beqz
+	case 017: // c.bnez
+		imm = bits(c, 12, 12) << 8 | bits(c, 11, 10) << 3 | bits(c, 6, 5) << 6 |
+				bits(c, 4, 3) << 1 | bits(c, 2, 2) << 5;
+		return enc_b(sext(imm, 9), 0, rs1p, bits(c, 13, 13));
+	case 020: // c.slli
+		return enc_i(bits(c, 12, 12) << 5 | rs2, rd, 1, rd, 0x13);
+	case 022: // c.lwsp
+		imm = bits(c, 12, 12) << 5 | bits(c, 6, 4) << 2 | bits(c, 3, 2) << 6;
+		return rd ? enc_i(imm, 2, 2, rd, 0x03) : 0;
+	case 024:
+		if (!bits(c, 12, 12)) {
+			if (!rs2) // c.jr
+				return rd ? enc_i(0, rd, 0, 0, 0x67) : 0;
+			return enc_r(0, rs2, 0, 0, rd, 0x33);                 // c.mv
+		}
+		if (!rd && !rs2) // c.ebreak
+			return 0x00100073;
+		if (!rs2) // c.jalr
+			return enc_i(0, rd, 0, 1, 0x67);
+		return enc_r(0, rs2, rd, 0, rd, 0x33);                        // c.add
+	case 026: // c.swsp
+		imm = bits(c, 12, 9) << 2 | bits(c, 8, 7) << 6;
+		return enc_s(imm, rs2, 2, 2);
+	}
+	return 0;
+}
+
+picorv32_iss::picorv32_iss()
+{
+	aes_init();
+	pc = PROGADDR_RESET;
+	memset(regs, 0, sizeof(regs));
+	memset(qregs, 0, sizeof(qregs));
+	irq_mask = ~0;
+	irq_pending = 0;
+	timer = 0;
+	irq_active = irq_delay = last_compr = false;
+	smz_base = smz_size = smz_enable = 0;
+	instret = cycle = 0;
+	memory.assign(MEM_SIZE/4, 0);
+	mem_smz_base = mem_smz_size = 0;
+	mem_smz_enable = false;
+	mem_smz_cipher = smz_cipher { SMZ_MODE_ADDR, { 0, 0, 0, 0 }, 0 };
+	smz_cache_hits = smz_cache_misses = 0;
+	cpi = 4;
+	trapped = tests_passed = false;
+}
+
+// the wrapper's irq[4] and irq[5] fire when the low 13 and 16 bits of its
+// cycle counter are all ones
+void picorv32_iss::advance(uint64_t n)
+{
+	if (timer) {
+		if (n >= timer) {
+			irq_pending |= 1 << irq_timer;
+			timer = 0;
+		} else
+			timer -= n;
+	}
+	if ((cycle + n + 1) / 8192 != (cycle + 1) / 8192)
+		irq_pending |= 1 << 4;
+	if ((cycle + n + 1) / 65536 != (cycle + 1) / 65536)
+		irq_pending |= 1 << 5;
+	cycle += n;
+	tb_dev_tick(n);
+}
+
+void picorv32_iss::raise(int irq)
+{
+	if (!(irq_mask & (1 << irq)) && !irq_active)
+		irq_pending |= 1 << irq;
+	else
+		trapped = true;
+}
+
+bool picorv32_iss::smz_secure(uint32_t addr)
+{
+	return mem_smz_enable && addr >= mem_smz_base && addr < (uint32_t)(mem_smz_base + mem_smz_size);
+}
+
+void picorv32_iss::smz_access(uint32_t addr)
+{
+	if (smz_cache_tag.empty() || !smz_secure(addr))
+		return;
+	uint32_t &tag = smz_cache_tag[(addr >> 4) & (smz_cache_tag.size() - 1)];
+	if (tag == ((addr & ~15) | 1)) {
+		smz_cache_hits++;
+	} else {
+		smz_cache_misses++;
+		tag = (addr & ~15) | 1;
+	}
+}
+
+bool picorv32_iss::load(uint32_t addr, int size, uint32_t &data)
+{
+	if (addr & (size - 1)) {
+		raise(irq_buserror);
+		return false;
+	}
+	uint32_t word_addr = addr & ~3;
+	smz_access(word_addr);
+	if (word_addr >= MEM_SIZE && tb_dev_read(word_addr, data)) {
+		data >>= 8 * (addr & 3);
+		return true;
+	}
+	if (word_addr >= MEM_SIZE) {
+		printf("ISS: OUT-OF-BOUNDS MEMORY READ FROM %08x\n", word_addr);
+		trapped = true;
+		return false;
+	}
+	uint32_t word = memory[word_addr >> 2];
+	if (smz_secure(word_addr))
+		word ^= smz_keystream(mem_smz_cipher, word_addr);
+	data = word >> (8 * (addr & 3));
+	return true;
+}
+
+bool picorv32_iss::store(uint32_t addr, int size, uint32_t data)
+{
+	if (addr & (size - 1)) {
+		raise(irq_buserror);
+		return false;
+	}
+	uint32_t word_addr = addr & ~3;
+	uint32_t wdata = size == 1 ? (data & 0xff) * 0x01010101 : size == 2 ? (data & 0xffff) * 0x00010001 : data;
+	uint32_t wmask = (size == 4 ? 0xffffffff : size == 2 ? 0xffff : 0xff) << (8 * (addr & 3));
+	smz_access(word_addr);
+	if (word_addr < MEM_SIZE) {
+		if (smz_secure(word_addr))
+			wdata ^= smz_keystream(mem_smz_cipher, word_addr);
+		memory[word_addr >> 2] = (memory[word_addr >> 2] & ~wmask) | (wdata & wmask);
+	} else
+	if (word_addr == 0x10000000) {
+		putchar(wdata & 0xff);
+		fflush(stdout);
+	} else
+	if (word_addr == 0x20000000) {
+		if (wdata == 123456789)
+			tests_passed = true;
+	} else
+	if (word_addr == 0x20000004) {
+		// traffic report of axi4_memory, not modelled
+	} else
+	if (tb_dev_write(word_addr, wdata, (wmask & 1) | (wmask >> 7 & 2) | (wmask >> 14 & 4) | (wmask >> 21 & 8))) {
+		// C++ device model
+	} else {
+		printf("ISS: OUT-OF-BOUNDS MEMORY WRITE TO %08x\n", word_addr);
+		trapped = true;
+		return false;
+	}
+	return true;
+}
+
+uint32_t picorv32_iss::fetch16(uint32_t addr)
+{
+	uint32_t data = 0;
+	load(addr & ~3, 4, data);
+	return (addr & 2) ? data >> 16 : data & 0xffff;
+}
+
+void picorv32_iss::waitirq(int rd)
+{
+	// skip ahead to the next external or timer interrupt
+	while (!irq_pending) {
+		uint64_t n = 8191 - (cycle & 8191);
+		if (n == 0)
+			n = 8192;
+		if (timer && timer < n)
+			n = timer;
+		advance(n);
+	}
+	if (rd)
+		regs[rd] = irq_pending;
+}
+
+void picorv32_iss::step()
+{
+	if (!irq_active && !irq_delay && (irq_pending & ~irq_mask)) {
+		qregs[0] = pc | last_compr;
+		qregs[1] = irq_pending & ~irq_mask;
+		irq_pending &= irq_mask;
+		irq_active = true;
+		pc = PROGADDR_IRQ;
+		advance(cpi);
+		return;
+	}
+
+	if (pc & 1) {
+		raise(irq_buserror);
+		return;
+	}
+
+	uint32_t insn = fetch16(pc);
+	bool compr = (insn & 3) != 3;
+	if (compr)
+		insn = expand_compressed(insn);
+	else
+		insn |= fetch16(pc + 2) << 16;
+	if (trapped)
+		return;
+
+	irq_delay = irq_active;
+	instret++;
+	advance(cpi);
+	execute(insn, compr);
+	last_compr = compr;
+	regs[0] = 0;
+}
+
+void picorv32_iss::execute(uint32_t insn, bool compr)
+{
+	int rd = bits(insn, 11, 7), rs1 = bits(insn, 19, 15), rs2 = bits(insn, 24, 20);
+	int f3 = bits(insn, 14, 12), f7 = bits(insn, 31, 25);
+	uint32_t a = regs[rs1], b = regs[rs2];
+	uint32_t imm_i = sext(insn >> 20, 12);
+	uint32_t imm_s = sext(f7 << 5 | rd, 12);
+	uint32_t imm_b = sext(bits(insn, 31, 31) << 12 | bits(insn, 7, 7) << 11 |
+			bits(insn, 30, 25) << 5 | bits(insn, 11, 8) << 1, 13);
+	uint32_t imm_j = sext(bits(insn, 31, 31) << 20 | bits(insn, 19, 12) << 12 |
+			bits(insn, 20, 20) << 11 | bits(insn, 30, 21) << 1, 21);
+	uint32_t next_pc = pc + (compr ? 2 : 4);
+	uint32_t data;
+
+	switch (insn & 0x7f)
+	{
+	case 0x37: // lui
+		regs[rd] = insn & 0xfffff000;
+		break;
+	case 0x17: // auipc
+		regs[rd] = pc + (insn & 0xfffff000);
+		break;
+	case 0x6f: // jal
+		regs[rd] = next_pc;
+		next_pc = pc + imm_j;
+		break;
+	case 0x67: // jalr
+		if (f3)
+			goto illegal;
+		next_pc = (a + imm_i) & ~1;
+		regs[rd] = pc + (compr ? 2 : 4);
+		break;
+	case 0x63: { // branches
+		bool taken;
+		switch (f3) {
+		case 0: taken = a == b; break;
+		case 1: taken = a != b; break;
+		case 4: taken = (int32_t)a < (int32_t)b; break;
+		case 5: taken = (int32_t)a >= (int32_t)b; break;
+		case 6: taken = a < b; break;
+		case 7: taken = a >= b; break;
+		default: goto illegal;
+		}
+		if (taken)
+			next_pc = pc + imm_b;
+		break;
+	}
+	case 0x03: // loads
+		switch (f3) {
+		case 0: if (load(a + imm_i, 1, data)) regs[rd] = sext(data & 0xff, 8); break;
+		case 1: if (load(a + imm_i, 2, data)) regs[rd] = sext(data & 0xffff, 16); break;
+		case 2: if (load(a + imm_i, 4, data)) regs[rd] = data; break;
+		case 4: if (load(a + imm_i, 1, data)) regs[rd] = data & 0xff; break;
+		case 5: if (load(a + imm_i, 2, data)) regs[rd] = data & 0xffff; break;
+		default: goto illegal;
+		}
+		break;
+	case 0x23: // stores
+		if (f3 > 2)
+			goto illegal;
+		store(a + imm_s, 1 << f3, b);
+		break;
+	case 0x13: // alu immediate
+		switch (f3) {
+		case 0: regs[rd] = a + imm_i; break;
+		case 2: regs[rd] = (int32_t)a < (int32_t)imm_i; break;
+		case 3: regs[rd] = a < imm_i; break;
+		case 4: regs[rd] = a ^ imm_i; break;
+		case 6: regs[rd] = a | imm_i; break;
+		case 7: regs[rd] = a & imm_i; break;
+		case 1:
+			if (bits(insn, 31, 22) == 0x040) {
+				switch (bits(insn, 21, 20)) {
+				case 0: regs[rd] = ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22); break;   // sha256sum0
+				case 1: regs[rd] = ror32(a, 6) ^ ror32(a, 11) ^ ror32(a, 25); break;   // sha256sum1
+				case 2: regs[rd] = ror32(a, 7) ^ ror32(a, 18) ^ (a >> 3); break;       // sha256sig0
+				case 3: regs[rd] = ror32(a, 17) ^ ror32(a, 19) ^ (a >> 10); break;     // sha256sig1
+				}
+				break;
+			}
+			if (f7)
+				goto illegal;
+			regs[rd] = a << rs2;
+			break;
+		case 5:
+			if (f7 == 0x00)
+				regs[rd] = a >> rs2;
+			else if (f7 == 0x20)
+				regs[rd] = (int32_t)a >> rs2;
+			else
+				goto illegal;
+			break;
+		}
+		break;
+	case 0x33: // alu register
+		if (f7 == 0x01) {
+			int64_t sa = (int32_t)a, sb = (int32_t)b;
+			switch (f3) {
+			case 0: regs[rd] = a * b; break;
+			case 1: regs[rd] = (uint64_t)(sa * sb) >> 32; break;
+			case 2: regs[rd] = (uint64_t)(sa * (int64_t)b) >> 32; break;
+			case 3: regs[rd] = ((uint64_t)a * b) >> 32; break;
+			case 4: regs[rd] = !b ? ~0u : (a == 0x80000000 && b == ~0u) ? a : (uint32_t)((int32_t)a / (int32_t)b); break;
+			case 5: regs[rd] = !b ? ~0u : a / b; break;
+			case 6: regs[rd] = !b ? a : (a == 0x80000000 && b == ~0u) ? 0 : (uint32_t)((int32_t)a % (int32_t)b); break;
+			case 7: regs[rd] = !b ? a : a % b; break;
+			}
+			break;
+		}
+		if (f7 == 0x05 && (f3 == 1 || f3 == 3)) { // clmul, clmulh
+			uint64_t p = clmul64(a, b);
+			regs[rd] = f3 == 1 ? (uint32_t)p : (uint32_t)(p >> 32);
+			break;
+		}
+		if (f3 == 0 && (f7 & 0x19) == 0x11) { // aes32{e,d}s{,m}i
+			regs[rd] = aes32(a, b, f7 >> 5, f7 & 4, f7 & 2);
+			break;
+		}
+		if (f7 == 0x20 && f3 == 0)
+			regs[rd] = a - b;
+		else if (f7 == 0x20 && f3 == 5)
+			regs[rd] = (int32_t)a >> (b & 31);
+		else if (f7)
+			goto illegal;
+		else switch (f3) {
+		case 0: regs[rd] = a + b; break;
+		case 1: regs[rd] = a << (b & 31); break;
+		case 2: regs[rd] = (int32_t)a < (int32_t)b; break;
+		case 3: regs[rd] = a < b; break;
+		case 4: regs[rd] = a ^ b; break;
+		case 5: regs[rd] = a >> (b & 31); break;
+		case 6: regs[rd] = a | b; break;
+		case 7: regs[rd] = a & b; break;
+		}
+		break;
+	case 0x0f: // fence
+		if (f3)
+			goto illegal;
+		break;
+	case 0x73: { // system
+		uint32_t csr = insn >> 20;
+		if (!bits(insn, 31, 21) && !bits(insn, 19, 7)) // ecall, ebreak
+			goto illegal;
+		if ((insn >> 12) == 0xc0002 || (insn >> 12) == 0xc0102)
+			regs[rd] = cycle;
+		else if ((insn >> 12) == 0xc8002 || (insn >> 12) == 0xc8102)
+			regs[rd] = cycle >> 32;
+		else if ((insn >> 12) == 0xc0202)
+			regs[rd] = instret;
+		else if ((insn >> 12) == 0xc8202)
+			regs[rd] = instret >> 32;
+		else if (csr >= 0x200 && csr <= 0x202 && f3) {
+			// like picorv32.v, every form but csrrs writes rs1
+			uint32_t *r = csr == 0x200 ? &smz_base : csr == 0x201 ? &smz_size : &smz_enable;
+			uint32_t old = *r;
+			if (f3 != 2)
+				*r = a;
+			regs[rd] = old;
+		} else
+			goto illegal;
+		break;
+	}
+	case 0x0b: // picorv32 custom0, see picorv32.v and firmware/custom_ops.S
+		switch (f7) {
+		case 0: regs[rd] = qregs[rs1 & 3]; break;                    // getq
+		case 1: qregs[rd & 3] = a; break;                            // setq
+		case 2: next_pc = qregs[0] & ~1; irq_active = false; break;  // retirq
+		case 3: regs[rd] = irq_mask; irq_mask = a; break;            // maskirq
+		case 4: waitirq(rd); break;                                  // waitirq
+		case 5: regs[rd] = timer; timer = a; break;                  // timer
+		default: goto illegal;
+		}
+		break;
+	default:
+	illegal:
+		// picorv32 decodes ebreak, ecall and illegal instructions alike
+		raise(irq_ebreak);
+		break;
+	}
+	pc = next_pc;
+}
+
+uint64_t picorv32_iss::run(uint64_t n)
+{
+	uint64_t start = instret;
+	while (!trapped && (instret - start < n || irq_active || (irq_pending & ~irq_mask)))
+		step();
+	return instret - start;
+}
@@ -0,0 +1,71 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Functional instruction set simulator for the Verilator testbench. It runs
+// the same firmware image as picorv32_wrapper (RV32IMC, the PicoRV32 IRQ
+// instructions, rdcycle/rdinstret and the SMZ CSRs) against a copy of the
+// axi4_memory contents, including its SMZ encryption and keystream cache,
+// so that testbench.cc can fast-forward a workload and hand the state over
+// to the RTL model (see +iss=<n>).
+//
+// The ISS has no notion of timing. Cycles are estimated as instructions
+// times +iss_cpi=<n>, which drives the timer and the external interrupts of
+// picorv32_wrapper (irq[4] every 8192 and irq[5] every 65536 cycles).
+
+#ifndef TESTBENCH_ISS_H
+#define TESTBENCH_ISS_H
+
+#include "scripts/libsmz/libsmz.h"
+#include <stdint.h>
+#include <vector>
+
+struct picorv32_iss
+{
+	// architectural state
+	uint32_t pc;
+	uint32_t regs[32];
+	uint32_t qregs[4];
+	uint32_t irq_mask, irq_pending, timer;
+	bool irq_active, irq_delay, last_compr;
+	uint32_t smz_base, smz_size, smz_enable;   // core CSRs 0x200..0x202
+	uint64_t instret, cycle;
+
+	// axi4_memory: raw (encrypted) word array and its SMZ configuration,
+	// which comes from the picorv32_wrapper registers, not the core CSRs
+	std::vector<uint32_t> memory;
+	uint32_t mem_smz_base, mem_smz_size;
+	bool mem_smz_enable;
+	smz_cipher mem_smz_cipher;
+
+	// axi4_memory keystream cache (+smz_cache_lines), tags as in testbench.v
+	std::vector<uint32_t> smz_cache_tag;
+	uint64_t smz_cache_hits, smz_cache_misses;
+
+	int cpi;
+	bool trapped, tests_passed;
+
+	picorv32_iss();
+
+	// execute instructions until the trap or until at least n have been
+	// executed and the ISS is at an instruction boundary outside of an IRQ
+	// handler, returns the number of executed instructions
+	uint64_t run(uint64_t n);
+	void step();
+
+private:
+	void advance(uint64_t cycles);
+	void raise(int irq);
+	bool smz_secure(uint32_t addr);
+	void smz_access(uint32_t addr);
+	bool load(uint32_t addr, int size, uint32_t &data);
+	bool store(uint32_t addr, int size, uint32_t data);
+	uint32_t fetch16(uint32_t addr);
+	void execute(uint32_t insn, bool compr);
+	void waitirq(int rd);
+};
+
+#endif
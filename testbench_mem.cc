@@ -0,0 +1,113 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+#include "testbench_mem.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+
+static uint32_t *banks[TB_MEM_BANKS];
+static int bank;
+
+void tb_mem_select(int b)
+{
+	bank = b;
+}
+
+uint32_t *tb_mem_words()
+{
+	if (!banks[bank]) {
+		void *p = mmap(NULL, TB_MEM_WORDS * 4, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		banks[bank] = (uint32_t*)p;
+	}
+	return banks[bank];
+}
+
+// map the binary image over the start of memory, the rest of the page after
+// the end of the file reads as zero
+static bool map_binary(const char *hexfile)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	std::string binfile = hexfile;
+	if (binfile.size() < 4 || binfile.compare(binfile.size() - 4, 4, ".hex"))
+		return false;
+	binfile.replace(binfile.size() - 4, 4, ".bin");
+
+	struct stat hex_st, bin_st;
+	int fd = open(binfile.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	bool ok = !fstat(fd, &bin_st) && !stat(hexfile, &hex_st) && bin_st.st_mtime <= hex_st.st_mtime &&
+			bin_st.st_size > 0 && bin_st.st_size <= TB_MEM_WORDS * 4 && bin_st.st_size % 4 == 0;
+	if (ok)
+		ok = mmap(tb_mem_words(), bin_st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED;
+	close(fd);
+	return ok;
+#else
+	(void)hexfile;
+	return false;
+#endif
+}
+
+bool tb_mem_load(const char *hexfile)
+{
+	uint32_t *mem = tb_mem_words();
+	if (map_binary(hexfile))
+		return true;
+
+	FILE *f = fopen(hexfile, "r");
+	if (!f) {
+		printf("Cannot open %s.\n", hexfile);
+		return false;
+	}
+	uint32_t addr = 0;
+	char token[64];
+	while (fscanf(f, "%63s", token) == 1) {
+		if (token[0] == '/' && token[1] == '/') {
+			int c;
+			while ((c = fgetc(f)) != EOF && c != '\n') { }
+		} else if (token[0] == '@') {
+			addr = strtoul(token + 1, NULL, 16);
+		} else if (addr < TB_MEM_WORDS) {
+			uint32_t w = strtoul(token, NULL, 16);
+			// untouched zero words stay on the shared zero page
+			if (w)
+				mem[addr] = w;
+			addr++;
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+// DPI functions imported by axi4_memory (testbench.v)
+
+extern "C" int tb_dpi_mem_load(const char *file)
+{
+	return tb_mem_load(file);
+}
+
+extern "C" int tb_dpi_mem_read(int index)
+{
+	return tb_mem_words()[(uint32_t)index % TB_MEM_WORDS];
+}
+
+extern "C" void tb_dpi_mem_write(int index, int data, int wstrb)
+{
+	uint32_t &w = tb_mem_words()[(uint32_t)index % TB_MEM_WORDS];
+	uint32_t mask = (wstrb & 1 ? 0xff : 0) | (wstrb & 2 ? 0xff00 : 0) | (wstrb & 4 ? 0xff0000 : 0) | (wstrb & 8 ? 0xff000000 : 0);
+	w = (w & ~mask) | ((uint32_t)data & mask);
+}
@@ -0,0 +1,35 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+
+// Backing store of axi4_memory in the Verilator testbench. The 128 KB are a
+// private mapping: the firmware image is mapped copy-on-write from the
+// binary next to the hex file (firmware/firmware.bin for
+// firmware/firmware.hex) when there is an up to date one, so that the
+// unmodified pages of the image are shared by all simulations running from
+// it (and by the children of the fork based modes) and startup does not
+// parse or copy the image. Otherwise the hex file is read as $readmemh
+// would. Only the pages that the simulation writes (including the
+// encryption of the SMZ region at load) are copied.
+
+#ifndef TESTBENCH_MEM_H
+#define TESTBENCH_MEM_H
+
+#include <stdint.h>
+
+#define TB_MEM_WORDS (128*1024/4)
+#define TB_MEM_BANKS 2
+
+// the memory words, as stored (SMZ region encrypted)
+uint32_t *tb_mem_words();
+
+// Model instances in the same process need a bank each: select it before
+// the first eval of the instance and before every eval after that.
+void tb_mem_select(int bank);
+
+bool tb_mem_load(const char *hexfile);
+
+#endif